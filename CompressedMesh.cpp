@@ -0,0 +1,415 @@
+#include "CompressedMesh.h"
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define COMPRESSED_MESH_SSE2
+#endif
+
+// File Header
+static const char compressedMeshMagic[4] = {'M', 'T', 'C', 'M'};
+static const int compressedMeshVersion = 1;
+
+// Compress the model's EBO vertices/indices
+CompressedMesh::CompressedMesh(Model* model) : CompressedMesh(model, false) {
+}
+
+CompressedMesh::CompressedMesh(Model* model, bool optimizeIndices) {
+    numVertices = model->getNumVertices(true);
+    numIndices = model->getNumIndices();
+    pair<float*, unsigned int*> arrays = model->generateEBOVerticesArray(glm::mat4(1), false, true);
+    float* vertexArray = arrays.first;
+    unsigned int* indexArray = arrays.second;
+
+    // Number vertices in the order the reordered triangles first use them, unused ones last
+    if (optimizeIndices) {
+        optimizeVertexCache(indexArray, numIndices, numVertices);
+
+        vector<int> remap(numVertices, -1);
+        int nextVertex = 0;
+        for (int i = 0; i < numIndices; i++) {
+            if (remap[indexArray[i]] == -1) {
+                remap[indexArray[i]] = nextVertex++;
+            }
+            indexArray[i] = remap[indexArray[i]];
+        }
+        for (int i = 0; i < numVertices; i++) {
+            if (remap[i] == -1) {
+                remap[i] = nextVertex++;
+            }
+        }
+
+        float* reordered = new float[numVertices * 11];
+        for (int i = 0; i < numVertices; i++) {
+            copy(vertexArray + i * 11, vertexArray + (i + 1) * 11, reordered + remap[i] * 11);
+        }
+        delete[] vertexArray;
+        vertexArray = reordered;
+    }
+
+    // Bounding Box
+    if (numVertices > 0) {
+        boundsMin = glm::vec3(vertexArray[0], vertexArray[1], vertexArray[2]);
+        boundsMax = boundsMin;
+    }
+    for (int i = 0; i < numVertices; i++) {
+        glm::vec3 position(vertexArray[i * 11], vertexArray[i * 11 + 1], vertexArray[i * 11 + 2]);
+        boundsMin = glm::min(boundsMin, position);
+        boundsMax = glm::max(boundsMax, position);
+    }
+    glm::vec3 extent = boundsMax - boundsMin;
+
+    // Quantize Vertices
+    packedVertices.resize(numVertices);
+    for (int i = 0; i < numVertices; i++) {
+        float* vertex = vertexArray + i * 11;
+        PackedVertex& packed = packedVertices.at(i);
+
+        for (int j = 0; j < 3; j++) {
+            float normalized = extent[j] > 0 ? (vertex[j] - boundsMin[j]) / extent[j] : 0;
+            packed.position[j] = (unsigned short) round(min(max(normalized, 0.0f), 1.0f) * 65535.0f);
+        }
+        packed.position[3] = 0;
+
+        for (int j = 0; j < 4; j++) {
+            packed.color[j] = (unsigned char) round(min(max(vertex[4 + j], 0.0f), 1.0f) * 255.0f);
+        }
+
+        encodeOctahedral(glm::vec3(vertex[8], vertex[9], vertex[10]), packed.normal);
+    }
+
+    // Zigzag encoded index deltas as variable length bytes
+    encodedIndices.reserve(numIndices);
+    unsigned int previous = 0;
+    for (int i = 0; i < numIndices; i++) {
+        int delta = (int) (indexArray[i] - previous);
+        unsigned int zigzag = ((unsigned int) delta << 1) ^ (unsigned int) (delta >> 31);
+        while (zigzag >= 0x80) {
+            encodedIndices.push_back((unsigned char) (zigzag | 0x80));
+            zigzag >>= 7;
+        }
+        encodedIndices.push_back((unsigned char) zigzag);
+        previous = indexArray[i];
+    }
+
+    delete[] vertexArray;
+    delete[] indexArray;
+}
+
+// Load a compressed file
+CompressedMesh::CompressedMesh(string fileName) {
+    ifstream file(fileName, ios::binary);
+    if (!file.is_open()) {
+        cout << "File: \'" + fileName + "\' failed to open." << endl;
+        return;
+    }
+
+    char magic[4];
+    int version = 0;
+    int numEncodedIndices = 0;
+    file.read(magic, sizeof(magic));
+    file.read((char*) &version, sizeof(version));
+    if (!file || !equal(magic, magic + 4, compressedMeshMagic) || version != compressedMeshVersion) {
+        cout << "File: \'" + fileName + "\' is not a compressed mesh." << endl;
+        return;
+    }
+
+    file.read((char*) &numVertices, sizeof(numVertices));
+    file.read((char*) &numIndices, sizeof(numIndices));
+    file.read((char*) &numEncodedIndices, sizeof(numEncodedIndices));
+    file.read((char*) &boundsMin, sizeof(boundsMin));
+    file.read((char*) &boundsMax, sizeof(boundsMax));
+
+    // Counts have to be whole triangles of at least a byte per index, and fit in the rest of the file
+    streamoff headerSize = file.tellg();
+    file.seekg(0, ios::end);
+    streamoff remaining = file.tellg() - headerSize;
+    file.seekg(headerSize);
+    bool valid = file && numVertices >= 0 && numIndices >= 0 && numIndices % 3 == 0 && numEncodedIndices >= numIndices;
+    if (!valid || (long long) numVertices * sizeof(PackedVertex) + numEncodedIndices > remaining) {
+        cout << "File: \'" + fileName + "\' is " << (valid ? "truncated." : "not a valid compressed mesh.") << endl;
+        numVertices = 0;
+        numIndices = 0;
+        return;
+    }
+
+    packedVertices.resize(numVertices);
+    encodedIndices.resize(numEncodedIndices);
+    file.read((char*) packedVertices.data(), numVertices * sizeof(PackedVertex));
+    file.read((char*) encodedIndices.data(), numEncodedIndices);
+
+    if (!file) {
+        cout << "File: \'" + fileName + "\' is truncated." << endl;
+        numVertices = 0;
+        numIndices = 0;
+        packedVertices.clear();
+        encodedIndices.clear();
+    }
+
+    file.close();
+}
+
+// Write a compressed file
+bool CompressedMesh::save(string fileName) {
+    ofstream file(fileName, ios::binary);
+    if (!file.is_open()) {
+        cout << "File: \'" + fileName + "\' failed to open." << endl;
+        return false;
+    }
+
+    int numEncodedIndices = encodedIndices.size();
+    file.write(compressedMeshMagic, sizeof(compressedMeshMagic));
+    file.write((char*) &compressedMeshVersion, sizeof(compressedMeshVersion));
+    file.write((char*) &numVertices, sizeof(numVertices));
+    file.write((char*) &numIndices, sizeof(numIndices));
+    file.write((char*) &numEncodedIndices, sizeof(numEncodedIndices));
+    file.write((char*) &boundsMin, sizeof(boundsMin));
+    file.write((char*) &boundsMax, sizeof(boundsMax));
+    file.write((char*) packedVertices.data(), numVertices * sizeof(PackedVertex));
+    file.write((char*) encodedIndices.data(), numEncodedIndices);
+    file.close();
+
+    return true;
+}
+
+// Decode into arrays of getNumVertices() * 11 floats and getNumIndices() indices
+bool CompressedMesh::decode(float* vertexArray, unsigned int* indexArray) {
+    glm::vec3 positionScale = (boundsMax - boundsMin) / 65535.0f;
+
+#ifdef COMPRESSED_MESH_SSE2
+    // Each packed vertex is one 16 byte load, w comes out as 0 * 0 + 1
+    __m128i zero = _mm_setzero_si128();
+    __m128 scale = _mm_setr_ps(positionScale.x, positionScale.y, positionScale.z, 0);
+    __m128 offset = _mm_setr_ps(boundsMin.x, boundsMin.y, boundsMin.z, 1);
+    __m128 colorScale = _mm_set1_ps(1.0f / 255.0f);
+    __m128 normalScale = _mm_set1_ps(1.0f / 32767.0f);
+    for (int i = 0; i < numVertices; i++) {
+        __m128i packed = _mm_loadu_si128((const __m128i*) &packedVertices[i]);
+        float* vertex = vertexArray + i * 11;
+
+        __m128 position = _mm_cvtepi32_ps(_mm_unpacklo_epi16(packed, zero));
+        _mm_storeu_ps(vertex, _mm_add_ps(_mm_mul_ps(position, scale), offset));
+
+        __m128i colorBytes = _mm_unpacklo_epi8(_mm_srli_si128(packed, 8), zero);
+        __m128 color = _mm_cvtepi32_ps(_mm_unpacklo_epi16(colorBytes, zero));
+        _mm_storeu_ps(vertex + 4, _mm_mul_ps(color, colorScale));
+
+        // Sign extend the two normal shorts
+        __m128i normalShorts = _mm_srai_epi32(_mm_unpacklo_epi16(zero, _mm_srli_si128(packed, 12)), 16);
+        float octahedral[4];
+        _mm_storeu_ps(octahedral, _mm_mul_ps(_mm_cvtepi32_ps(normalShorts), normalScale));
+
+        float x = octahedral[0];
+        float y = octahedral[1];
+        float z = 1.0f - fabs(x) - fabs(y);
+        float t = max(-z, 0.0f);
+        x += x >= 0 ? -t : t;
+        y += y >= 0 ? -t : t;
+        float inverseLength = 1.0f / sqrt(x * x + y * y + z * z);
+        vertex[8] = x * inverseLength;
+        vertex[9] = y * inverseLength;
+        vertex[10] = z * inverseLength;
+    }
+#else
+    for (int i = 0; i < numVertices; i++) {
+        PackedVertex& packed = packedVertices[i];
+        float* vertex = vertexArray + i * 11;
+
+        vertex[0] = packed.position[0] * positionScale.x + boundsMin.x;
+        vertex[1] = packed.position[1] * positionScale.y + boundsMin.y;
+        vertex[2] = packed.position[2] * positionScale.z + boundsMin.z;
+        vertex[3] = 1.0f;
+
+        for (int j = 0; j < 4; j++) {
+            vertex[4 + j] = packed.color[j] / 255.0f;
+        }
+
+        glm::vec3 normal = decodeOctahedral(packed.normal[0], packed.normal[1]);
+        vertex[8] = normal.x;
+        vertex[9] = normal.y;
+        vertex[10] = normal.z;
+    }
+#endif
+
+    // Indices (a varint is at most 5 bytes, and every index has to be a vertex)
+    unsigned int previous = 0;
+    int position = 0;
+    for (int i = 0; i < numIndices; i++) {
+        unsigned int zigzag = 0;
+        int shift = 0;
+        unsigned char byte;
+        do {
+            if (position >= encodedIndices.size() || shift > 28) {
+                return false;
+            }
+            byte = encodedIndices[position++];
+            zigzag |= (unsigned int) (byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+
+        int delta = (int) (zigzag >> 1) ^ -(int) (zigzag & 1);
+        previous += delta;
+        if (previous >= numVertices) {
+            return false;
+        }
+        indexArray[i] = previous;
+    }
+
+    return true;
+}
+
+// Greedy triangle order for a post-transform vertex cache (Forsyth's linear-speed method). Vertices
+// score higher the more recently they were used and the fewer triangles they have left, and the next
+// triangle is the best one using a cached vertex, or the next unused one in order when none is left.
+void CompressedMesh::optimizeVertexCache(unsigned int* indexArray, int numIndices, int numVertices) {
+    const int cacheSize = 32;
+    int numTriangles = numIndices / 3;
+
+    // Triangles of each vertex (CSR, the first remaining[i] are the ones not emitted yet)
+    vector<int> offsets(numVertices + 1, 0);
+    for (int i = 0; i < numTriangles * 3; i++) {
+        offsets[indexArray[i] + 1]++;
+    }
+    for (int i = 0; i < numVertices; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+    vector<int> remaining(numVertices);
+    vector<int> vertexTriangles(numTriangles * 3);
+    for (int i = 0; i < numVertices; i++) {
+        remaining[i] = offsets[i + 1] - offsets[i];
+    }
+    vector<int> position(offsets.begin(), offsets.end() - 1);
+    for (int i = 0; i < numTriangles * 3; i++) {
+        vertexTriangles[position[indexArray[i]]++] = i / 3;
+    }
+
+    vector<int> cachePositions(numVertices, -1);
+    auto vertexScore = [&](int vertex) {
+        if (remaining[vertex] == 0) {
+            return -1.0f;
+        }
+
+        // The last triangle's vertices get a fixed score so it is not repeated straight away
+        float score = 0;
+        int cachePosition = cachePositions[vertex];
+        if (cachePosition >= 3) {
+            score = pow(1.0f - (cachePosition - 3) / (float) (cacheSize - 3), 1.5f);
+        }
+        else if (cachePosition >= 0) {
+            score = 0.75f;
+        }
+        return score + 2.0f / sqrt((float) remaining[vertex]);
+    };
+
+    vector<float> vertexScores(numVertices);
+    for (int i = 0; i < numVertices; i++) {
+        vertexScores[i] = vertexScore(i);
+    }
+
+    vector<char> emitted(numTriangles, 0);
+    vector<unsigned int> result;
+    result.reserve(numTriangles * 3);
+    vector<int> cache;
+    vector<int> newCache;
+    int best = -1;
+    int nextUnused = 0;
+    while (result.size() < numTriangles * 3) {
+        if (best == -1) {
+            while (emitted[nextUnused]) {
+                nextUnused++;
+            }
+            best = nextUnused;
+        }
+
+        // Emit the triangle and take it off its vertices' lists
+        emitted[best] = 1;
+        newCache.clear();
+        for (int i = 0; i < 3; i++) {
+            int vertex = indexArray[best * 3 + i];
+            result.push_back(vertex);
+            newCache.push_back(vertex);
+
+            int* triangles = vertexTriangles.data() + offsets[vertex];
+            int* found = find(triangles, triangles + remaining[vertex], best);
+            swap(*found, triangles[--remaining[vertex]]);
+        }
+
+        // Its vertices move to the front of the cache
+        for (int i = 0; i < cache.size(); i++) {
+            if (find(newCache.begin(), newCache.begin() + 3, cache[i]) == newCache.begin() + 3) {
+                newCache.push_back(cache[i]);
+            }
+        }
+        for (int i = 0; i < newCache.size(); i++) {
+            cachePositions[newCache[i]] = i < cacheSize ? i : -1;
+            vertexScores[newCache[i]] = vertexScore(newCache[i]);
+        }
+
+        // Rescore the remaining triangles of every vertex that was in the cache
+        best = -1;
+        float bestScore = -1;
+        for (int i = 0; i < newCache.size(); i++) {
+            int vertex = newCache[i];
+            for (int j = 0; j < remaining[vertex]; j++) {
+                int triangle = vertexTriangles[offsets[vertex] + j];
+                float score = 0;
+                for (int k = 0; k < 3; k++) {
+                    score += vertexScores[indexArray[triangle * 3 + k]];
+                }
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = triangle;
+                }
+            }
+        }
+
+        newCache.resize(min((int) newCache.size(), cacheSize));
+        swap(cache, newCache);
+    }
+
+    copy(result.begin(), result.end(), indexArray);
+}
+
+// Project a unit normal onto the octahedron, folding the lower half over
+void CompressedMesh::encodeOctahedral(glm::vec3 normal, short* result) {
+    float length = fabs(normal.x) + fabs(normal.y) + fabs(normal.z);
+    if (!(length > 0)) {
+        result[0] = 0;
+        result[1] = 0;
+        return;
+    }
+
+    float x = normal.x / length;
+    float y = normal.y / length;
+    if (normal.z < 0) {
+        float foldedX = (1.0f - fabs(y)) * (x >= 0 ? 1.0f : -1.0f);
+        float foldedY = (1.0f - fabs(x)) * (y >= 0 ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    result[0] = (short) round(min(max(x, -1.0f), 1.0f) * 32767.0f);
+    result[1] = (short) round(min(max(y, -1.0f), 1.0f) * 32767.0f);
+}
+
+// Inverse of encodeOctahedral
+glm::vec3 CompressedMesh::decodeOctahedral(short x, short y) {
+    glm::vec3 normal(x / 32767.0f, y / 32767.0f, 0);
+    normal.z = 1.0f - fabs(normal.x) - fabs(normal.y);
+    float t = max(-normal.z, 0.0f);
+    normal.x += normal.x >= 0 ? -t : t;
+    normal.y += normal.y >= 0 ? -t : t;
+    return glm::normalize(normal);
+}
+
+// Sizes
+int CompressedMesh::getNumVertices() {
+    return numVertices;
+}
+int CompressedMesh::getNumIndices() {
+    return numIndices;
+}
+size_t CompressedMesh::getCompressedSize() {
+    return packedVertices.size() * sizeof(PackedVertex) + encodedIndices.size();
+}
+size_t CompressedMesh::getDecodedSize() {
+    return (size_t) numVertices * 11 * sizeof(float) + (size_t) numIndices * sizeof(unsigned int);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "Model.h"
+
+// Quantized copy of a model's EBO vertices/indices. Positions are 16 bit inside the
+// bounding box, normals are octahedral, and indices are zigzag delta varints.
+class CompressedMesh {
+    // Packed Vertex (16 bytes instead of 44)
+    struct PackedVertex {
+        unsigned short position[4];
+        unsigned char color[4];
+        short normal[2];
+    };
+
+    // Bounding box positions are quantized in
+    glm::vec3 boundsMin = glm::vec3(0, 0, 0);
+    glm::vec3 boundsMax = glm::vec3(0, 0, 0);
+
+    int numVertices = 0;
+    int numIndices = 0;
+    vector<PackedVertex> packedVertices;
+    vector<unsigned char> encodedIndices;
+
+    static void optimizeVertexCache(unsigned int* indexArray, int numIndices, int numVertices);
+    static void encodeOctahedral(glm::vec3 normal, short* result);
+    static glm::vec3 decodeOctahedral(short x, short y);
+
+public:
+    // Compress a model, optionally reordering its triangles for the vertex cache and its vertices
+    // by first use (smaller index deltas), or load a compressed file
+    CompressedMesh(Model* model);
+    CompressedMesh(Model* model, bool optimizeIndices);
+    CompressedMesh(string fileName);
+
+    bool save(string fileName);
+
+    // Decode straight into the generateEBOVerticesArray layout (11 floats per vertex), false when
+    // the indices are corrupt (a varint runs past the data or an index is not a vertex)
+    bool decode(float* vertexArray, unsigned int* indexArray);
+
+    int getNumVertices();
+    int getNumIndices();
+    size_t getCompressedSize();
+    size_t getDecodedSize();
+};
@@ -0,0 +1,320 @@
+#include "FrameCapture.h"
+
+// Constructor
+FrameCapture::FrameCapture(int width, int height, int ringSize, int maxQueue, Format format, Policy policy, string prefix) {
+    this->width = width;
+    this->height = height;
+    this->format = format;
+    this->policy = policy;
+    this->prefix = prefix;
+    this->maxQueue = max(maxQueue, 1);
+
+    // Pixel buffers are only read by the CPU, so they are allocated for streaming reads
+    ringSize = max(ringSize, 1);
+    pixelBuffers.resize(ringSize);
+    fences.assign(ringSize, nullptr);
+    slotFrames.assign(ringSize, -1);
+    glGenBuffers(ringSize, pixelBuffers.data());
+    for (int i = 0; i < ringSize; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, width * height * 4, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (format == Format::Raw) {
+        string fileName = prefix + to_string(width) + "x" + to_string(height) + ".rgba";
+        rawFile.open(fileName, ios::binary);
+        if (!rawFile.is_open()) {
+            cout << "File: \'" << fileName << "\' failed to open." << endl;
+        }
+    }
+
+    encoder = thread(&FrameCapture::encodeLoop, this);
+}
+
+FrameCapture::~FrameCapture() {
+    finish();
+
+    {
+        lock_guard<mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueChanged.notify_all();
+    encoder.join();
+
+    glDeleteBuffers(pixelBuffers.size(), pixelBuffers.data());
+}
+
+// Start reading this frame into the next slot, then hand on every older frame that is done
+void FrameCapture::capture(long frame) {
+    int ringSize = pixelBuffers.size();
+
+    // A full ring has to wait for its oldest frame
+    if (slotFrames[nextSlot] != -1) {
+        readSlot(nextSlot, true);
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[nextSlot]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    fences[nextSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slotFrames[nextSlot] = frame;
+    numCaptured++;
+
+    // Oldest first, stopping at the first one still in flight so frames stay in order
+    nextSlot = (nextSlot + 1) % ringSize;
+    for (int i = 0; i < ringSize - 1; i++) {
+        int slot = (nextSlot + i) % ringSize;
+        if (slotFrames[slot] == -1) {
+            continue;
+        }
+        GLenum status = glClientWaitSync(fences[slot], 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        readSlot(slot, false);
+    }
+}
+
+// Map a slot's buffer, waiting for its fence if asked to, and queue its pixels
+void FrameCapture::readSlot(int slot, bool wait) {
+    if (wait) {
+        auto start = chrono::high_resolution_clock::now();
+        GLenum status = GL_TIMEOUT_EXPIRED;
+        while (status == GL_TIMEOUT_EXPIRED) {
+            status = glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 100000000);
+        }
+        auto finish = chrono::high_resolution_clock::now();
+        stallTime += chrono::duration_cast<chrono::microseconds>(finish - start).count();
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+    auto pixels = (const unsigned char*) glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, width * height * 4, GL_MAP_READ_BIT);
+    if (pixels) {
+        enqueue(slotFrames[slot], pixels);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    else {
+        numDropped++;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    glDeleteSync(fences[slot]);
+    fences[slot] = nullptr;
+    slotFrames[slot] = -1;
+}
+
+// Copy the pixels into a free buffer, or drop/block on a full queue
+void FrameCapture::enqueue(long frame, const unsigned char* pixels) {
+    unique_lock<mutex> lock(queueMutex);
+    if (queue.size() >= maxQueue) {
+        if (policy == Policy::Drop) {
+            numDropped++;
+            return;
+        }
+
+        auto start = chrono::high_resolution_clock::now();
+        queueChanged.wait(lock, [this]() {
+            return queue.size() < maxQueue;
+        });
+        auto finish = chrono::high_resolution_clock::now();
+        blockTime += chrono::duration_cast<chrono::microseconds>(finish - start).count();
+    }
+
+    vector<unsigned char> buffer;
+    if (!freeBuffers.empty()) {
+        buffer = move(freeBuffers.back());
+        freeBuffers.pop_back();
+    }
+    lock.unlock();
+
+    buffer.assign(pixels, pixels + width * height * 4);
+
+    lock.lock();
+    queue.push_back(make_pair(frame, move(buffer)));
+    lock.unlock();
+    queueChanged.notify_all();
+}
+
+// Encoder Thread
+void FrameCapture::encodeLoop() {
+    unique_lock<mutex> lock(queueMutex);
+    while (true) {
+        queueChanged.wait(lock, [this]() {
+            return stopping || !queue.empty();
+        });
+        if (queue.empty()) {
+            break;
+        }
+
+        auto entry = move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+
+        writeFrame(entry.first, entry.second);
+
+        lock.lock();
+        freeBuffers.push_back(move(entry.second));
+        numWritten++;
+        queueChanged.notify_all();
+    }
+}
+
+void FrameCapture::writeFrame(long frame, const vector<unsigned char>& pixels) {
+    if (format == Format::Raw) {
+        rawFile.write((const char*) pixels.data(), pixels.size());
+        return;
+    }
+
+    stringstream fileName;
+    fileName << prefix << setw(6) << setfill('0') << frame << (format == Format::PNG ? ".png" : ".ppm");
+    if (format == Format::PNG) {
+        writePNG(fileName.str(), pixels);
+    }
+    else {
+        writePPM(fileName.str(), pixels);
+    }
+}
+
+// Binary PPM (P6), flipped so the top row is first
+void FrameCapture::writePPM(string fileName, const vector<unsigned char>& pixels) {
+    ofstream file(fileName, ios::binary);
+    if (!file.is_open()) {
+        cout << "File: \'" << fileName << "\' failed to open." << endl;
+        return;
+    }
+
+    vector<unsigned char> row(width * 3);
+    file << "P6\n" << width << " " << height << "\n255\n";
+    for (int y = height - 1; y >= 0; y--) {
+        for (int x = 0; x < width; x++) {
+            for (int j = 0; j < 3; j++) {
+                row[x * 3 + j] = pixels[(y * width + x) * 4 + j];
+            }
+        }
+        file.write((const char*) row.data(), row.size());
+    }
+}
+
+// PNG with stored (uncompressed) deflate blocks, so no zlib is needed
+void FrameCapture::writePNG(string fileName, const vector<unsigned char>& pixels) {
+    ofstream file(fileName, ios::binary);
+    if (!file.is_open()) {
+        cout << "File: \'" << fileName << "\' failed to open." << endl;
+        return;
+    }
+
+    static unsigned int crcTable[256];
+    static once_flag crcTableFlag;
+    call_once(crcTableFlag, []() {
+        for (unsigned int i = 0; i < 256; i++) {
+            unsigned int crc = i;
+            for (int j = 0; j < 8; j++) {
+                crc = crc & 1 ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+            }
+            crcTable[i] = crc;
+        }
+    });
+
+    auto putInt = [](vector<unsigned char>& data, unsigned int value) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            data.push_back((value >> shift) & 0xFF);
+        }
+    };
+
+    // Chunks are length, type, data, then the CRC of type and data
+    auto writeChunk = [&](const char* type, const vector<unsigned char>& data) {
+        vector<unsigned char> chunk;
+        putInt(chunk, data.size());
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+
+        unsigned int crc = 0xFFFFFFFFu;
+        for (int i = 4; i < chunk.size(); i++) {
+            crc = crcTable[(crc ^ chunk[i]) & 0xFF] ^ (crc >> 8);
+        }
+        putInt(chunk, crc ^ 0xFFFFFFFFu);
+        file.write((const char*) chunk.data(), chunk.size());
+    };
+
+    // 8 bit RGBA, each row starts with filter type 0 (none), top row first
+    vector<unsigned char> header;
+    putInt(header, width);
+    putInt(header, height);
+    header.insert(header.end(), {8, 6, 0, 0, 0});
+
+    int rowSize = width * 4 + 1;
+    vector<unsigned char> raw(rowSize * height);
+    for (int y = 0; y < height; y++) {
+        raw[y * rowSize] = 0;
+        copy(pixels.begin() + (height - 1 - y) * width * 4, pixels.begin() + (height - y) * width * 4, raw.begin() + y * rowSize + 1);
+    }
+
+    // Zlib stream: header, stored blocks of at most 65535 bytes, Adler-32 of the raw data
+    vector<unsigned char> data = {0x78, 0x01};
+    data.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    for (size_t offset = 0; offset < raw.size(); offset += 65535) {
+        unsigned int length = min<size_t>(65535, raw.size() - offset);
+        data.push_back(offset + length == raw.size() ? 1 : 0);
+        data.push_back(length & 0xFF);
+        data.push_back(length >> 8);
+        data.push_back(~length & 0xFF);
+        data.push_back((~length >> 8) & 0xFF);
+        data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + length);
+    }
+
+    unsigned int a = 1, b = 0;
+    for (int i = 0; i < raw.size(); i++) {
+        a = (a + raw[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    putInt(data, (b << 16) | a);
+
+    const unsigned char signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write((const char*) signature, sizeof(signature));
+    writeChunk("IHDR", header);
+    writeChunk("IDAT", data);
+    writeChunk("IEND", {});
+}
+
+// Read back the ring in order, then wait for the queue to empty
+void FrameCapture::finish() {
+    int ringSize = pixelBuffers.size();
+    for (int i = 0; i < ringSize; i++) {
+        int slot = (nextSlot + i) % ringSize;
+        if (slotFrames[slot] != -1) {
+            readSlot(slot, true);
+        }
+    }
+
+    unique_lock<mutex> lock(queueMutex);
+    queueChanged.wait(lock, [this]() {
+        return queue.empty() && numWritten + numDropped == numCaptured;
+    });
+    if (rawFile.is_open()) {
+        rawFile.flush();
+    }
+}
+
+// Statistics
+long FrameCapture::getNumCaptured() {
+    return numCaptured;
+}
+
+long FrameCapture::getNumDropped() {
+    return numDropped;
+}
+
+long FrameCapture::getNumWritten() {
+    lock_guard<mutex> lock(queueMutex);
+    return numWritten;
+}
+
+long FrameCapture::getBlockTime() {
+    return blockTime;
+}
+
+long FrameCapture::getStallTime() {
+    return stallTime;
+}
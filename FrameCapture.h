@@ -0,0 +1,78 @@
+#pragma once
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+using namespace std;
+
+// Reads frames back through a ring of pixel buffer objects, each fenced so it is only
+// mapped once the GPU has written it, and hands them to a background thread to encode
+class FrameCapture {
+public:
+    // PPM/PNG write a file per frame, Raw appends RGBA frames (bottom row first) to one file
+    enum class Format {PPM, PNG, Raw};
+
+    // When the queue is full, Drop skips the frame and Block waits for the encoder
+    enum class Policy {Drop, Block};
+
+private:
+    int width, height;
+    Format format;
+    Policy policy;
+    string prefix;
+    int maxQueue;
+
+    // Pixel Buffer Ring (frame -1 when the slot is free)
+    vector<unsigned int> pixelBuffers;
+    vector<GLsync> fences;
+    vector<long> slotFrames;
+    int nextSlot = 0;
+
+    // Encoder Queue (frames waiting, and buffers to reuse)
+    thread encoder;
+    mutex queueMutex;
+    condition_variable queueChanged;
+    deque<pair<long, vector<unsigned char>>> queue;
+    vector<vector<unsigned char>> freeBuffers;
+    bool stopping = false;
+    ofstream rawFile;
+
+    // Statistics (times in microseconds)
+    long numCaptured = 0;
+    long numDropped = 0;
+    long numWritten = 0;
+    long blockTime = 0;
+    long stallTime = 0;
+
+    void readSlot(int slot, bool wait);
+    void enqueue(long frame, const unsigned char* pixels);
+    void encodeLoop();
+    void writeFrame(long frame, const vector<unsigned char>& pixels);
+    void writePPM(string fileName, const vector<unsigned char>& pixels);
+    void writePNG(string fileName, const vector<unsigned char>& pixels);
+
+public:
+    // Captures the bottom left width * height pixels of the current framebuffer
+    FrameCapture(int width, int height, int ringSize, int maxQueue, Format format, Policy policy, string prefix);
+    ~FrameCapture();
+
+    // Call after drawing and before swapping buffers
+    void capture(long frame);
+
+    // Read back every pending frame and wait for the encoder to write them
+    void finish();
+
+    long getNumCaptured();
+    long getNumDropped();
+    long getNumWritten();
+    long getBlockTime();
+    long getStallTime();
+};
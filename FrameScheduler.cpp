@@ -0,0 +1,140 @@
+#include "FrameScheduler.h"
+#include <GLFW/glfw3.h>
+#include <thread>
+#include <cmath>
+
+// Constructor
+FrameScheduler::FrameScheduler(double inputTimeStep, double idleWaitTimeout, double targetFrameRate, bool continuous) {
+    this->inputTimeStep = inputTimeStep;
+    this->idleWaitTimeout = idleWaitTimeout;
+    this->targetFrameTime = targetFrameRate > 0 ? 1.0 / targetFrameRate : 0;
+    this->continuous = continuous;
+
+    runStart = Clock::now();
+    lastTime = runStart;
+}
+
+// Duration to seconds
+double FrameScheduler::seconds(Clock::duration duration) {
+    return chrono::duration_cast<chrono::duration<double>>(duration).count();
+}
+
+// Add the real time passed and take as many fixed steps as fit
+int FrameScheduler::beginFrame() {
+    Clock::time_point now = Clock::now();
+    accumulator += seconds(now - lastTime);
+    lastTime = now;
+
+    int steps = (int) (accumulator / inputTimeStep);
+    accumulator -= steps * inputTimeStep;
+
+    // Drop time instead of spiralling after a long stall
+    if (steps > maxInputSteps) {
+        steps = maxInputSteps;
+        accumulator = 0;
+    }
+
+    return steps;
+}
+
+double FrameScheduler::getInputTimeStep() {
+    return inputTimeStep;
+}
+
+// Frame Timing
+void FrameScheduler::startRender() {
+    frameStart = Clock::now();
+}
+void FrameScheduler::endRender(bool vsync) {
+    // Swap already waits for the display with vsync, otherwise sleep to the target
+    if (!vsync && targetFrameTime > 0) {
+        Clock::time_point target = frameStart + chrono::duration_cast<Clock::duration>(chrono::duration<double>(targetFrameTime));
+        Clock::time_point sleepStart = Clock::now();
+        if (sleepStart < target) {
+            this_thread::sleep_until(target);
+            waitTime += seconds(Clock::now() - sleepStart);
+        }
+    }
+
+    Clock::time_point now = Clock::now();
+    frameTimes.push_back(seconds(now - frameStart));
+    if (hasLastFrame) {
+        frameIntervals.push_back(seconds(now - lastFrameEnd));
+    }
+    lastFrameEnd = now;
+    hasLastFrame = true;
+}
+
+// Wait for input when nothing is moving
+void FrameScheduler::waitForEvents(bool active) {
+    if (continuous || active) {
+        glfwPollEvents();
+        return;
+    }
+
+    Clock::time_point waitStart = Clock::now();
+    glfwWaitEventsTimeout(idleWaitTimeout);
+    Clock::time_point waitEnd = Clock::now();
+    waitTime += seconds(waitEnd - waitStart);
+
+    // Idle time is not integrated, but a key press still gets one step
+    lastTime = waitEnd;
+    accumulator = inputTimeStep;
+    hasLastFrame = false;
+}
+
+// Frame times sorted for the percentiles (all zero without frames)
+FrameScheduler::FrameStatistics FrameScheduler::getFrameStatistics() {
+    FrameStatistics statistics = {0, 0, 0, 0, 0, 0};
+    if (frameTimes.empty()) {
+        return statistics;
+    }
+
+    vector<long> sorted;
+    for (int i = 0; i < frameTimes.size(); i++) {
+        sorted.push_back((long) (1000000.0 * frameTimes.at(i)));
+    }
+    sort(sorted.begin(), sorted.end());
+
+    statistics.numFrames = sorted.size();
+    for (int i = 0; i < sorted.size(); i++) {
+        statistics.total += sorted.at(i);
+    }
+    statistics.average = statistics.total / statistics.numFrames;
+    statistics.median = sorted.at(sorted.size() / 2);
+    statistics.percentile95 = sorted.at(sorted.size() * 95 / 100);
+    statistics.max = sorted.back();
+    return statistics;
+}
+
+// Output the statistics of the run
+void FrameScheduler::printStatistics() {
+    double runTime = seconds(Clock::now() - runStart);
+    double busy = runTime > 0 ? 100.0 * (runTime - waitTime) / runTime : 0;
+    cout << "Scheduler: " << frameTimes.size() << " frames in " << runTime << " seconds, busy " << busy << "% of the time." << endl;
+
+    if (frameTimes.size() > 0) {
+        double total = 0;
+        for (int i = 0; i < frameTimes.size(); i++) {
+            total += frameTimes.at(i);
+        }
+        cout << "Scheduler: Average Frame Time: " << 1000000.0 * total / frameTimes.size() << " microseconds." << endl;
+    }
+
+    // Jitter is the standard deviation of the time between frames
+    if (frameIntervals.size() > 1) {
+        double mean = 0;
+        for (int i = 0; i < frameIntervals.size(); i++) {
+            mean += frameIntervals.at(i);
+        }
+        mean /= frameIntervals.size();
+
+        double variance = 0;
+        for (int i = 0; i < frameIntervals.size(); i++) {
+            variance += (frameIntervals.at(i) - mean) * (frameIntervals.at(i) - mean);
+        }
+        variance /= frameIntervals.size();
+
+        cout << "Scheduler: Frame Interval: " << 1000000.0 * mean << " microseconds, jitter: " << 1000000.0 * sqrt(variance) << " microseconds." << endl;
+    }
+}
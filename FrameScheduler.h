@@ -0,0 +1,65 @@
+#pragma once
+#include <chrono>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+using namespace std;
+
+class FrameScheduler {
+public:
+    // Frame time statistics of the run (microseconds)
+    struct FrameStatistics {
+        long numFrames;
+        long total;
+        long average;
+        long median;
+        long percentile95;
+        long max;
+    };
+
+private:
+    typedef chrono::steady_clock Clock;
+
+    // Settings
+    double inputTimeStep;
+    double idleWaitTimeout;
+    double targetFrameTime;
+    bool continuous;
+    int maxInputSteps = 10;
+
+    // Fixed Timestep Accumulation
+    Clock::time_point lastTime;
+    double accumulator = 0;
+
+    // Current Frame
+    Clock::time_point frameStart;
+    Clock::time_point lastFrameEnd;
+    bool hasLastFrame = false;
+
+    // Statistics
+    Clock::time_point runStart;
+    double waitTime = 0;
+    vector<double> frameTimes;
+    vector<double> frameIntervals;
+
+    static double seconds(Clock::duration duration);
+
+public:
+    // targetFrameRate only limits frames when vsync is off (0 for unlimited)
+    FrameScheduler(double inputTimeStep, double idleWaitTimeout, double targetFrameRate, bool continuous);
+
+    // Number of fixed input steps to integrate for the real time passed
+    int beginFrame();
+    double getInputTimeStep();
+
+    // Record the frame's time and pace to the target frame rate
+    void startRender();
+    void endRender(bool vsync);
+
+    // Poll while active, otherwise sleep until an event (or the timeout)
+    void waitForEvents(bool active);
+
+    // Busy percentage, frame time, and jitter of the whole run
+    void printStatistics();
+    FrameStatistics getFrameStatistics();
+};
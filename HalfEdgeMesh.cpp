@@ -0,0 +1,290 @@
+#include "HalfEdgeMesh.h"
+
+// Constructors
+HalfEdgeMesh::HalfEdgeMesh(vector<int> triangleVertices, int numVertices, int numThreads) {
+    this->origins = move(triangleVertices);
+    this->numVertices = numVertices;
+    this->numThreads = numThreads;
+    build();
+}
+
+HalfEdgeMesh::HalfEdgeMesh(Model* model, int numThreads) : HalfEdgeMesh(model->getTriangleVertices(), model->getNumPositions(), numThreads) {
+}
+
+// Match twins by sorting: a counting sort puts every half-edge in the bucket of its lower
+// vertex, then each bucket is sorted by the upper vertex in parallel so the half-edges of an
+// edge are next to each other. Buckets are owned by one thread, so there are no shared writes.
+void HalfEdgeMesh::build() {
+    auto start = chrono::high_resolution_clock::now();
+    int numHalfEdges = origins.size();
+    twins.assign(numHalfEdges, -1);
+
+    // Count, then place, the half-edges of each lower vertex
+    vector<int> bucketOffsets(numVertices + 1, 0);
+    for (int i = 0; i < numHalfEdges; i++) {
+        bucketOffsets[min(origin(i), target(i)) + 1]++;
+    }
+    for (int i = 0; i < numVertices; i++) {
+        bucketOffsets[i + 1] += bucketOffsets[i];
+    }
+
+    vector<int> position(bucketOffsets.begin(), bucketOffsets.end() - 1);
+    vector<int> bucketHalfEdges(numHalfEdges);
+    for (int i = 0; i < numHalfEdges; i++) {
+        bucketHalfEdges[position[min(origin(i), target(i))]++] = i;
+    }
+
+    atomic<int> boundaryCount(0);
+    atomic<int> nonManifoldCount(0);
+    parallelFor(numVertices, numThreads, [&](int first, int last) {
+        int numBoundary = 0;
+        int numNonManifold = 0;
+        auto upper = [this](int halfEdge) {
+            return max(origin(halfEdge), target(halfEdge));
+        };
+
+        for (int i = first; i < last; i++) {
+            auto bucketStart = bucketHalfEdges.begin() + bucketOffsets[i];
+            auto bucketEnd = bucketHalfEdges.begin() + bucketOffsets[i + 1];
+            sort(bucketStart, bucketEnd, [&](int a, int b) {
+                return upper(a) < upper(b) || (upper(a) == upper(b) && a < b);
+            });
+
+            // Runs of the same edge: one is a boundary, two opposite ones are twins, anything else is non-manifold
+            for (auto run = bucketStart; run != bucketEnd;) {
+                auto runEnd = run + 1;
+                while (runEnd != bucketEnd && upper(*runEnd) == upper(*run)) {
+                    runEnd++;
+                }
+
+                if (runEnd - run == 1) {
+                    numBoundary++;
+                }
+                else if (runEnd - run == 2 && origin(run[0]) == target(run[1])) {
+                    twins[run[0]] = run[1];
+                    twins[run[1]] = run[0];
+                }
+                else {
+                    numNonManifold++;
+                }
+                run = runEnd;
+            }
+        }
+
+        boundaryCount += numBoundary;
+        nonManifoldCount += numNonManifold;
+    });
+    numBoundaryHalfEdges = boundaryCount;
+    numNonManifoldEdges = nonManifoldCount;
+
+    // Outgoing half-edge of each vertex, preferring a boundary one so walks around it start at the boundary
+    vector<int> degrees(numVertices, 0);
+    vertexHalfEdges.assign(numVertices, -1);
+    for (int i = 0; i < numHalfEdges; i++) {
+        int vertex = origin(i);
+        degrees[vertex]++;
+        if (vertexHalfEdges[vertex] == -1 || (twins[i] == -1 && twins[vertexHalfEdges[vertex]] != -1)) {
+            vertexHalfEdges[vertex] = i;
+        }
+    }
+
+    // A vertex with more than one fan does not reach all its half-edges from one of them
+    atomic<int> nonManifoldVertexCount(0);
+    parallelFor(numVertices, numThreads, [&](int first, int last) {
+        int numNonManifold = 0;
+        for (int i = first; i < last; i++) {
+            int numReached = 0;
+            Range fan = aroundVertex(i);
+            for (Iterator halfEdge = fan.begin(); halfEdge != fan.end(); ++halfEdge) {
+                numReached++;
+            }
+            if (numReached != degrees[i]) {
+                numNonManifold++;
+            }
+        }
+        nonManifoldVertexCount += numNonManifold;
+    });
+    numNonManifoldVertices = nonManifoldVertexCount;
+
+    auto finish = chrono::high_resolution_clock::now();
+    buildTime = chrono::duration_cast<chrono::microseconds>(finish - start).count();
+}
+
+// Sizes
+int HalfEdgeMesh::getNumVertices() {
+    return numVertices;
+}
+
+int HalfEdgeMesh::getNumFaces() {
+    return origins.size() / 3;
+}
+
+int HalfEdgeMesh::getNumHalfEdges() {
+    return origins.size();
+}
+
+// Navigation
+int HalfEdgeMesh::next(int halfEdge) {
+    return halfEdge % 3 == 2 ? halfEdge - 2 : halfEdge + 1;
+}
+
+int HalfEdgeMesh::prev(int halfEdge) {
+    return halfEdge % 3 == 0 ? halfEdge + 2 : halfEdge - 1;
+}
+
+int HalfEdgeMesh::twin(int halfEdge) {
+    return twins[halfEdge];
+}
+
+int HalfEdgeMesh::face(int halfEdge) {
+    return halfEdge / 3;
+}
+
+int HalfEdgeMesh::origin(int halfEdge) {
+    return origins[halfEdge];
+}
+
+int HalfEdgeMesh::target(int halfEdge) {
+    return origins[next(halfEdge)];
+}
+
+int HalfEdgeMesh::getHalfEdge(int vertex) {
+    return vertexHalfEdges[vertex];
+}
+
+bool HalfEdgeMesh::isBoundary(int halfEdge) {
+    return twins[halfEdge] == -1;
+}
+
+bool HalfEdgeMesh::isBoundaryVertex(int vertex) {
+    return vertexHalfEdges[vertex] != -1 && twins[vertexHalfEdges[vertex]] == -1;
+}
+
+// Ranges
+HalfEdgeMesh::Range HalfEdgeMesh::aroundVertex(int vertex) {
+    return {Iterator(this, vertexHalfEdges[vertex], Iterator::AroundVertex), Iterator(this, -1, Iterator::AroundVertex)};
+}
+
+HalfEdgeMesh::Range HalfEdgeMesh::aroundFace(int face) {
+    return {Iterator(this, face * 3, Iterator::AroundFace), Iterator(this, -1, Iterator::AroundFace)};
+}
+
+HalfEdgeMesh::Range HalfEdgeMesh::alongBoundary(int halfEdge) {
+    return {Iterator(this, isBoundary(halfEdge) ? halfEdge : -1, Iterator::AlongBoundary), Iterator(this, -1, Iterator::AlongBoundary)};
+}
+
+// Queries
+vector<int> HalfEdgeMesh::getOneRing(int vertex) {
+    vector<int> ring;
+    int last = -1;
+    for (int halfEdge : aroundVertex(vertex)) {
+        ring.push_back(target(halfEdge));
+        last = halfEdge;
+    }
+
+    // A boundary fan ends with an incoming edge that has no outgoing twin
+    if (last != -1 && isBoundary(prev(last))) {
+        ring.push_back(origin(prev(last)));
+    }
+
+    return ring;
+}
+
+vector<int> HalfEdgeMesh::getFaceNeighbors(int face) {
+    vector<int> neighbors;
+    for (int halfEdge : aroundFace(face)) {
+        neighbors.push_back(isBoundary(halfEdge) ? -1 : this->face(twin(halfEdge)));
+    }
+
+    return neighbors;
+}
+
+vector<vector<int>> HalfEdgeMesh::getBoundaryLoops() {
+    vector<vector<int>> loops;
+    vector<char> visited(origins.size(), 0);
+    for (int i = 0; i < origins.size(); i++) {
+        if (!isBoundary(i) || visited[i]) {
+            continue;
+        }
+
+        vector<int> loop;
+        for (int halfEdge : alongBoundary(i)) {
+            if (visited[halfEdge]) {
+                break;
+            }
+            visited[halfEdge] = 1;
+            loop.push_back(halfEdge);
+        }
+        loops.push_back(loop);
+    }
+
+    return loops;
+}
+
+bool HalfEdgeMesh::isManifold() {
+    return numNonManifoldEdges == 0 && numNonManifoldVertices == 0;
+}
+
+int HalfEdgeMesh::getNumBoundaryHalfEdges() {
+    return numBoundaryHalfEdges;
+}
+
+int HalfEdgeMesh::getNumNonManifoldEdges() {
+    return numNonManifoldEdges;
+}
+
+int HalfEdgeMesh::getNumNonManifoldVertices() {
+    return numNonManifoldVertices;
+}
+
+long HalfEdgeMesh::getBuildTime() {
+    return buildTime;
+}
+
+// Iterator
+HalfEdgeMesh::Iterator::Iterator(HalfEdgeMesh* mesh, int halfEdge, Walk walk) {
+    this->mesh = mesh;
+    this->first = halfEdge;
+    this->current = halfEdge;
+    this->steps = 0;
+    this->walk = walk;
+}
+
+int HalfEdgeMesh::Iterator::operator*() const {
+    return current;
+}
+
+// Step to the next half-edge, -1 once back at the first or at a boundary
+HalfEdgeMesh::Iterator& HalfEdgeMesh::Iterator::operator++() {
+    if (walk == AroundVertex) {
+        current = mesh->twin(mesh->prev(current));
+    }
+    else if (walk == AroundFace) {
+        current = mesh->next(current);
+    }
+    else {
+        // Non-manifold vertices can lead into a loop without the first half-edge, so the steps are limited
+        current = mesh->getHalfEdge(mesh->target(current));
+        if (!mesh->isBoundary(current) || ++steps >= mesh->getNumHalfEdges()) {
+            current = -1;
+        }
+    }
+
+    if (current == first) {
+        current = -1;
+    }
+
+    return *this;
+}
+
+bool HalfEdgeMesh::Iterator::operator!=(const Iterator& other) const {
+    return current != other.current;
+}
+
+HalfEdgeMesh::Iterator HalfEdgeMesh::Range::begin() {
+    return first;
+}
+
+HalfEdgeMesh::Iterator HalfEdgeMesh::Range::end() {
+    return last;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "Model.h"
+#include <atomic>
+
+// Index based half-edge connectivity of a triangle mesh. Half-edge h is corner
+// h % 3 of face h / 3 and goes from that corner to the next, so next/prev/face
+// are arithmetic and only the origin vertex and twin are stored per half-edge.
+class HalfEdgeMesh {
+    int numVertices;
+    int numThreads;
+
+    // Per Half-Edge (twin is -1 on boundaries and non-manifold edges)
+    vector<int> origins;
+    vector<int> twins;
+
+    // One outgoing half-edge per vertex, the boundary one if there is one (-1 if unused)
+    vector<int> vertexHalfEdges;
+
+    int numBoundaryHalfEdges = 0;
+    int numNonManifoldEdges = 0;
+    int numNonManifoldVertices = 0;
+    long buildTime = 0;
+
+    void build();
+
+public:
+    // Walks over half-edges, ending when it returns to the first one or runs out
+    class Iterator {
+    public:
+        enum Walk {AroundVertex, AroundFace, AlongBoundary};
+        Iterator(HalfEdgeMesh* mesh, int halfEdge, Walk walk);
+        int operator*() const;
+        Iterator& operator++();
+        bool operator!=(const Iterator& other) const;
+
+    private:
+        HalfEdgeMesh* mesh;
+        int first, current;
+        int steps;
+        Walk walk;
+    };
+
+    // Range for range based for loops
+    struct Range {
+        Iterator first, last;
+        Iterator begin();
+        Iterator end();
+    };
+
+    // Triangle corners are 0 based vertex indices, three per face
+    HalfEdgeMesh(vector<int> triangleVertices, int numVertices, int numThreads);
+    HalfEdgeMesh(Model* model, int numThreads);
+
+    int getNumVertices();
+    int getNumFaces();
+    int getNumHalfEdges();
+
+    // Navigation
+    int next(int halfEdge);
+    int prev(int halfEdge);
+    int twin(int halfEdge);
+    int face(int halfEdge);
+    int origin(int halfEdge);
+    int target(int halfEdge);
+    int getHalfEdge(int vertex);
+    bool isBoundary(int halfEdge);
+    bool isBoundaryVertex(int vertex);
+
+    // Outgoing half-edges of a vertex (one fan of a non-manifold vertex), half-edges of a
+    // face, and boundary half-edges of the loop through a boundary half-edge
+    Range aroundVertex(int vertex);
+    Range aroundFace(int face);
+    Range alongBoundary(int halfEdge);
+
+    // Neighbors of a vertex in order around it (one-ring), and faces across each edge of a face (-1 for none)
+    vector<int> getOneRing(int vertex);
+    vector<int> getFaceNeighbors(int face);
+
+    // Every boundary loop as its half-edges
+    vector<vector<int>> getBoundaryLoops();
+
+    // Manifold when every edge has at most two faces of matching orientation and every vertex one fan
+    bool isManifold();
+    int getNumBoundaryHalfEdges();
+    int getNumNonManifoldEdges();
+    int getNumNonManifoldVertices();
+    long getBuildTime();
+};
@@ -0,0 +1,80 @@
+#include "HalfEdgeMesh.h"
+using namespace std;
+
+// Entry Point: builds small meshes with known connectivity and checks twins, one-rings, boundaries and non-manifold counts
+int main() {
+    // Settings
+        vector<int> threadCounts = {1, 3};
+
+    int numFailed = 0;
+    auto check = [&](string name, bool value) {
+        cout << "Half-Edge Mesh: " << name << ": " << (value ? "passed" : "FAILED") << "." << endl;
+        if (!value) {
+            numFailed++;
+        }
+    };
+
+    // Every twin points back and runs the other way
+    auto twinsConsistent = [](HalfEdgeMesh& mesh) {
+        for (int i = 0; i < mesh.getNumHalfEdges(); i++) {
+            int twin = mesh.twin(i);
+            if (twin != -1 && (mesh.twin(twin) != i || mesh.origin(twin) != mesh.target(i) || mesh.target(twin) != mesh.origin(i))) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    auto countTwins = [](HalfEdgeMesh& mesh) {
+        int numTwins = 0;
+        for (int i = 0; i < mesh.getNumHalfEdges(); i++) {
+            numTwins += mesh.twin(i) != -1;
+        }
+        return numTwins;
+    };
+
+    for (int t = 0; t < threadCounts.size(); t++) {
+        string threads = " (" + to_string(threadCounts.at(t)) + " threads)";
+
+        // Closed tetrahedron, every face wound outwards
+        HalfEdgeMesh tetrahedron({0, 2, 1, 0, 1, 3, 0, 3, 2, 1, 2, 3}, 4, threadCounts.at(t));
+        vector<int> ring = tetrahedron.getOneRing(0);
+        sort(ring.begin(), ring.end());
+        check("tetrahedron twins" + threads, twinsConsistent(tetrahedron) && countTwins(tetrahedron) == 12);
+        check("tetrahedron one-ring" + threads, ring == vector<int>({1, 2, 3}));
+        check("tetrahedron has no boundary" + threads, tetrahedron.getNumBoundaryHalfEdges() == 0 && tetrahedron.getBoundaryLoops().empty() && !tetrahedron.isBoundaryVertex(0));
+        check("tetrahedron is manifold" + threads, tetrahedron.isManifold() && tetrahedron.getNumNonManifoldEdges() == 0 && tetrahedron.getNumNonManifoldVertices() == 0);
+        vector<int> neighbors = tetrahedron.getFaceNeighbors(0);
+        sort(neighbors.begin(), neighbors.end());
+        check("tetrahedron face neighbors" + threads, neighbors == vector<int>({1, 2, 3}));
+
+        // Quad of two triangles sharing the diagonal 0-2
+        HalfEdgeMesh quad({0, 1, 2, 0, 2, 3}, 4, threadCounts.at(t));
+        vector<vector<int>> quadLoops = quad.getBoundaryLoops();
+        check("quad twins" + threads, twinsConsistent(quad) && countTwins(quad) == 2 && quad.twin(2) == 3);
+        check("quad boundary fan one-ring" + threads, quad.getOneRing(0) == vector<int>({1, 2, 3}) && quad.getOneRing(1) == vector<int>({2, 0}));
+        check("quad boundary loop" + threads, quad.getNumBoundaryHalfEdges() == 4 && quadLoops.size() == 1 && quadLoops.at(0).size() == 4);
+        check("quad boundary vertices" + threads, quad.isBoundaryVertex(0) && quad.isBoundaryVertex(1) && quad.isBoundaryVertex(2) && quad.isBoundaryVertex(3));
+        check("quad face neighbors" + threads, quad.getFaceNeighbors(0) == vector<int>({-1, -1, 1}));
+        check("quad is manifold" + threads, quad.isManifold());
+
+        // Bowtie: two triangles sharing only vertex 0, which has two fans
+        HalfEdgeMesh bowtie({0, 1, 2, 0, 3, 4}, 5, threadCounts.at(t));
+        vector<vector<int>> bowtieLoops = bowtie.getBoundaryLoops();
+        check("bowtie has no twins" + threads, countTwins(bowtie) == 0);
+        check("bowtie boundary loops" + threads, bowtie.getNumBoundaryHalfEdges() == 6 && bowtieLoops.size() == 2 && bowtieLoops.at(0).size() + bowtieLoops.at(1).size() == 6);
+        check("bowtie non-manifold vertex" + threads, !bowtie.isManifold() && bowtie.getNumNonManifoldEdges() == 0 && bowtie.getNumNonManifoldVertices() == 1);
+
+        // Fin: three triangles on the edge 0-1, which gets no twins
+        HalfEdgeMesh fin({0, 1, 2, 1, 0, 3, 0, 1, 4}, 5, threadCounts.at(t));
+        check("fin edge has no twins" + threads, twinsConsistent(fin) && countTwins(fin) == 0);
+        check("fin non-manifold edge" + threads, !fin.isManifold() && fin.getNumNonManifoldEdges() == 1 && fin.getNumBoundaryHalfEdges() == 6);
+        check("fin non-manifold vertices" + threads, fin.getNumNonManifoldVertices() == 2);
+
+        // Two triangles on the edge 0-1 in the same direction (one flipped) are not twins
+        HalfEdgeMesh flipped({0, 1, 2, 0, 1, 3}, 4, threadCounts.at(t));
+        check("same direction pair has no twins" + threads, countTwins(flipped) == 0 && flipped.getNumNonManifoldEdges() == 1 && !flipped.isManifold());
+    }
+
+    return numFailed > 0 ? 1 : 0;
+}
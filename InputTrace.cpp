@@ -0,0 +1,155 @@
+#include "InputTrace.h"
+#include <GLFW/glfw3.h>
+
+// GLFW key of each key mask bit
+static const int glfwKeys[InputTrace::NumKeys] = {
+    GLFW_KEY_ESCAPE, GLFW_KEY_UP, GLFW_KEY_DOWN, GLFW_KEY_LEFT, GLFW_KEY_RIGHT, GLFW_KEY_PAGE_UP, GLFW_KEY_PAGE_DOWN,
+    GLFW_KEY_R, GLFW_KEY_T, GLFW_KEY_Y, GLFW_KEY_U, GLFW_KEY_I, GLFW_KEY_O,
+    GLFW_KEY_F, GLFW_KEY_G, GLFW_KEY_H, GLFW_KEY_J, GLFW_KEY_K, GLFW_KEY_L,
+    GLFW_KEY_Z, GLFW_KEY_X
+};
+
+// Constructor
+InputTrace::InputTrace(Mode mode, string fileName, double timeStep) {
+    this->mode = mode;
+    this->fileName = fileName;
+    this->timeStep = timeStep;
+
+    if (mode == Mode::Replay && !load()) {
+        cout << "Input Trace: replay failed, using live input." << endl;
+        this->mode = Mode::Live;
+    }
+}
+
+InputTrace::Mode InputTrace::getMode() {
+    return mode;
+}
+
+double InputTrace::getTimeStep() {
+    return timeStep;
+}
+
+unsigned int InputTrace::poll(GLFWwindow* window) {
+    unsigned int mask = 0;
+    for (int i = 0; i < NumKeys; i++) {
+        if (glfwGetKey(window, glfwKeys[i]) == GLFW_PRESS) {
+            mask |= 1u << i;
+        }
+    }
+
+    return mask;
+}
+
+unsigned int InputTrace::next(GLFWwindow* window) {
+    if (mode == Mode::Replay) {
+        while (nextEvent < events.size() && events.at(nextEvent).step <= numSteps) {
+            keys = events.at(nextEvent).keys;
+            nextEvent++;
+        }
+        numSteps++;
+
+        // Escape on the window still ends a replay
+        return keys | (poll(window) & (1u << Escape));
+    }
+
+    unsigned int mask = poll(window);
+    if (mode == Mode::Record) {
+        double now = glfwGetTime();
+        if (recordStart < 0) {
+            recordStart = now;
+        }
+        if (events.empty() || mask != keys) {
+            events.push_back({numSteps, now - recordStart, mask});
+        }
+        keys = mask;
+        numSteps++;
+    }
+
+    return mask;
+}
+
+bool InputTrace::isFinished() {
+    return mode == Mode::Replay && numSteps > events.back().step;
+}
+
+// Text file: "InputTrace <time step> <steps>", then "<step> <seconds> <key mask>" per key change
+bool InputTrace::save() {
+    if (mode != Mode::Record) {
+        return false;
+    }
+
+    ofstream file(fileName);
+    if (!file.is_open()) {
+        cout << "File: \'" << fileName << "\' failed to open." << endl;
+        return false;
+    }
+
+    file.precision(17);
+    file << "InputTrace " << timeStep << " " << numSteps << endl;
+    for (int i = 0; i < events.size(); i++) {
+        file << events.at(i).step << " " << events.at(i).time << " " << events.at(i).keys << endl;
+    }
+
+    cout << "Input Trace: recorded " << numSteps << " steps, " << events.size() << " key changes to \'" << fileName << "\'." << endl;
+    return (bool) file;
+}
+
+// The last event repeats the final mask at the last step, so replays end where recording did
+bool InputTrace::load() {
+    ifstream file(fileName);
+    if (!file.is_open()) {
+        cout << "File: \'" << fileName << "\' failed to open." << endl;
+        return false;
+    }
+
+    string magic;
+    long recordedSteps = 0;
+    file >> magic >> timeStep >> recordedSteps;
+    if (magic != "InputTrace" || timeStep <= 0) {
+        cout << "File: \'" << fileName << "\' is not an input trace." << endl;
+        return false;
+    }
+
+    Event event;
+    while (file >> event.step >> event.time >> event.keys) {
+        events.push_back(event);
+    }
+    if (events.empty() || recordedSteps <= 0) {
+        cout << "File: \'" << fileName << "\' has no input steps." << endl;
+        return false;
+    }
+
+    events.push_back({recordedSteps - 1, events.back().time, events.back().keys});
+    return true;
+}
+
+// Timing Report
+void InputTrace::printReport(FrameScheduler::FrameStatistics statistics) {
+    if (statistics.numFrames == 0) {
+        return;
+    }
+
+    cout << "Input Trace: " << numSteps << " steps, " << statistics.numFrames << " frames, " << statistics.total << " microseconds total." << endl;
+    cout << "Input Trace: Frame Time: average " << statistics.average << ", median " << statistics.median << ", 95th percentile " << statistics.percentile95 << ", max " << statistics.max << " microseconds." << endl;
+}
+
+// One line per run, the header is written when the file is new
+bool InputTrace::writeReport(string reportFileName, string configuration, FrameScheduler::FrameStatistics statistics) {
+    if (statistics.numFrames == 0) {
+        return false;
+    }
+
+    bool exists = ifstream(reportFileName).good();
+    ofstream file(reportFileName, ios::app);
+    if (!file.is_open()) {
+        cout << "File: \'" << reportFileName << "\' failed to open." << endl;
+        return false;
+    }
+
+    if (!exists) {
+        file << "trace,configuration,steps,frames,total,average,median,p95,max" << endl;
+    }
+    file << fileName << "," << configuration << "," << numSteps << "," << statistics.numFrames << "," << statistics.total << "," << statistics.average << ",";
+    file << statistics.median << "," << statistics.percentile95 << "," << statistics.max << endl;
+    return (bool) file;
+}
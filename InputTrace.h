@@ -0,0 +1,66 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include "FrameScheduler.h"
+using namespace std;
+
+struct GLFWwindow;
+
+// Source of the key state of each fixed input step: polled from the window (Live), polled and
+// kept to save as a trace (Record), or read back from a saved trace (Replay). Traces hold the
+// step length and the key mask whenever it changes, so replays move through the same poses.
+class InputTrace {
+public:
+    enum class Mode {Live, Record, Replay};
+
+    // Key mask bits
+    enum Key {
+        Escape, Up, Down, Left, Right, PageUp, PageDown,
+        RotateXMinus, RotateXPlus, RotateYMinus, RotateYPlus, RotateZMinus, RotateZPlus,
+        ScaleXPlus, ScaleXMinus, ScaleYPlus, ScaleYMinus, ScaleZPlus, ScaleZMinus,
+        FovMinus, FovPlus, NumKeys
+    };
+
+private:
+    // Key change: the step it happened at, seconds since recording started, and the new mask
+    struct Event {
+        long step;
+        double time;
+        unsigned int keys;
+    };
+
+    Mode mode;
+    string fileName;
+    double timeStep;
+    vector<Event> events;
+    long numSteps = 0;
+    int nextEvent = 0;
+    unsigned int keys = 0;
+    double recordStart = -1;
+
+    static unsigned int poll(GLFWwindow* window);
+    bool load();
+
+public:
+    // Replay takes the time step from the trace, falling back to Live when it does not load
+    InputTrace(Mode mode, string fileName, double timeStep);
+
+    Mode getMode();
+    double getTimeStep();
+
+    // Key mask of the next input step
+    unsigned int next(GLFWwindow* window);
+
+    // Replays are finished after their last recorded step
+    bool isFinished();
+
+    // Write a recorded trace
+    bool save();
+
+    // Frame times of a replay (from the frame scheduler), printed and appended to a CSV file with a description of the run
+    void printReport(FrameScheduler::FrameStatistics statistics);
+    bool writeReport(string reportFileName, string configuration, FrameScheduler::FrameStatistics statistics);
+};
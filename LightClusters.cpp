@@ -0,0 +1,211 @@
+#include "LightClusters.h"
+#include <chrono>
+
+// Constructors
+LightClusters::PointLight::PointLight(glm::vec3 position, float radius, glm::vec3 color, float intensity) {
+    this->position = position;
+    this->radius = radius;
+    this->color = color;
+    this->intensity = intensity;
+}
+LightClusters::LightClusters(int clustersX, int clustersY, int clustersZ, int numThreads) {
+    this->clustersX = clustersX;
+    this->clustersY = clustersY;
+    this->clustersZ = clustersZ;
+    this->numThreads = numThreads;
+    clusterGrid.assign(clustersX * clustersY * clustersZ * 2, 0);
+}
+
+// Depth slices grow exponentially from the near to the far plane
+int LightClusters::getSlice(float depth) {
+    if (depth <= nearClippingPlane) {
+        return 0;
+    }
+
+    int slice = (int) floor(log(depth / nearClippingPlane) / log(farClippingPlane / nearClippingPlane) * clustersZ);
+    return min(max(slice, 0), clustersZ - 1);
+}
+float LightClusters::getSliceDepth(int slice) {
+    return nearClippingPlane * pow(farClippingPlane / nearClippingPlane, (float) slice / clustersZ);
+}
+
+// View space bounding box of every cluster
+void LightClusters::setFrustum(float fov, float aspectRatio, float nearClippingPlane, float farClippingPlane) {
+    if (fov == this->fov && aspectRatio == this->aspectRatio && nearClippingPlane == this->nearClippingPlane && farClippingPlane == this->farClippingPlane) {
+        return;
+    }
+
+    this->fov = fov;
+    this->aspectRatio = aspectRatio;
+    this->nearClippingPlane = nearClippingPlane;
+    this->farClippingPlane = farClippingPlane;
+
+    float tanY = tan(glm::radians(fov) / 2);
+    float tanX = tanY * aspectRatio;
+    clusterMin.resize(clustersX * clustersY * clustersZ);
+    clusterMax.resize(clustersX * clustersY * clustersZ);
+    for (int z = 0; z < clustersZ; z++) {
+        float nearDepth = getSliceDepth(z);
+        float farDepth = getSliceDepth(z + 1);
+        for (int y = 0; y < clustersY; y++) {
+            float bottom = (2.0f * y / clustersY - 1) * tanY;
+            float top = (2.0f * (y + 1) / clustersY - 1) * tanY;
+            for (int x = 0; x < clustersX; x++) {
+                float left = (2.0f * x / clustersX - 1) * tanX;
+                float right = (2.0f * (x + 1) / clustersX - 1) * tanX;
+
+                // Tile edges spread with depth, so take both ends of the slice
+                int cluster = (z * clustersY + y) * clustersX + x;
+                clusterMin[cluster] = glm::vec3(min(left * nearDepth, left * farDepth), min(bottom * nearDepth, bottom * farDepth), -farDepth);
+                clusterMax[cluster] = glm::vec3(max(right * nearDepth, right * farDepth), max(top * nearDepth, top * farDepth), -nearDepth);
+            }
+        }
+    }
+}
+
+// Lights are binned per depth slice in parallel, each thread owning whole
+// slices, then the lists are joined in cluster order
+void LightClusters::assign(const vector<PointLight>& lights, glm::mat4 viewMatrix) {
+    auto start = chrono::high_resolution_clock::now();
+    int numLights = lights.size();
+    int clustersPerSlice = clustersX * clustersY;
+    float tanY = tan(glm::radians(fov) / 2);
+    float tanX = tanY * aspectRatio;
+
+    // View space lights and the range of clusters each can reach
+    vector<glm::vec4> viewLights(numLights);
+    vector<glm::ivec3> rangeMin(numLights);
+    vector<glm::ivec3> rangeMax(numLights);
+    lightData.resize(numLights * 8);
+    parallelFor(numLights, numThreads, [&](int first, int last) {
+        for (int i = first; i < last; i++) {
+            const PointLight& light = lights[i];
+            glm::vec3 position = glm::vec3(viewMatrix * glm::vec4(light.position, 1));
+            float radius = light.radius;
+            float depth = -position.z;
+            viewLights[i] = glm::vec4(position, radius);
+
+            float* data = &lightData[i * 8];
+            data[0] = position.x;
+            data[1] = position.y;
+            data[2] = position.z;
+            data[3] = radius;
+            data[4] = light.color.x;
+            data[5] = light.color.y;
+            data[6] = light.color.z;
+            data[7] = light.intensity;
+
+            // Entirely behind the camera or past the far plane
+            if (depth + radius < nearClippingPlane || depth - radius > farClippingPlane) {
+                rangeMin[i] = glm::ivec3(0, 0, 1);
+                rangeMax[i] = glm::ivec3(-1, -1, 0);
+                continue;
+            }
+
+            rangeMin[i] = glm::ivec3(0, 0, getSlice(depth - radius));
+            rangeMax[i] = glm::ivec3(clustersX - 1, clustersY - 1, getSlice(depth + radius));
+
+            // Project the light's bounding box when it is fully in front of the near plane
+            if (depth - radius > nearClippingPlane) {
+                float minX = 1, maxX = -1, minY = 1, maxY = -1;
+                for (int corner = 0; corner < 8; corner++) {
+                    float cornerX = position.x + ((corner & 1) ? radius : -radius);
+                    float cornerY = position.y + ((corner & 2) ? radius : -radius);
+                    float cornerDepth = depth + ((corner & 4) ? radius : -radius);
+                    minX = min(minX, cornerX / (cornerDepth * tanX));
+                    maxX = max(maxX, cornerX / (cornerDepth * tanX));
+                    minY = min(minY, cornerY / (cornerDepth * tanY));
+                    maxY = max(maxY, cornerY / (cornerDepth * tanY));
+                }
+
+                rangeMin[i].x = max(0, (int) floor((minX * 0.5f + 0.5f) * clustersX));
+                rangeMax[i].x = min(clustersX - 1, (int) floor((maxX * 0.5f + 0.5f) * clustersX));
+                rangeMin[i].y = max(0, (int) floor((minY * 0.5f + 0.5f) * clustersY));
+                rangeMax[i].y = min(clustersY - 1, (int) floor((maxY * 0.5f + 0.5f) * clustersY));
+            }
+        }
+    });
+
+    // Each slice writes only its own counts and index list
+    vector<vector<unsigned int>> sliceIndices(clustersZ);
+    parallelFor(clustersZ, numThreads, [&](int first, int last) {
+        vector<vector<unsigned int>> clusterLights(clustersPerSlice);
+        for (int z = first; z < last; z++) {
+            for (int i = 0; i < clustersPerSlice; i++) {
+                clusterLights[i].clear();
+            }
+
+            for (int i = 0; i < numLights; i++) {
+                if (z < rangeMin[i].z || z > rangeMax[i].z) {
+                    continue;
+                }
+
+                glm::vec3 center = glm::vec3(viewLights[i]);
+                float radiusSquared = viewLights[i].w * viewLights[i].w;
+                for (int y = rangeMin[i].y; y <= rangeMax[i].y; y++) {
+                    for (int x = rangeMin[i].x; x <= rangeMax[i].x; x++) {
+                        // Sphere against the cluster's box
+                        int cluster = (z * clustersY + y) * clustersX + x;
+                        glm::vec3 closest = glm::clamp(center, clusterMin[cluster], clusterMax[cluster]);
+                        glm::vec3 difference = closest - center;
+                        if (glm::dot(difference, difference) <= radiusSquared) {
+                            clusterLights[y * clustersX + x].push_back(i);
+                        }
+                    }
+                }
+            }
+
+            for (int i = 0; i < clustersPerSlice; i++) {
+                clusterGrid[(z * clustersPerSlice + i) * 2 + 1] = clusterLights[i].size();
+                sliceIndices[z].insert(sliceIndices[z].end(), clusterLights[i].begin(), clusterLights[i].end());
+            }
+        }
+    });
+
+    // Offsets in cluster order, dropping what doesn't fit in the index buffer
+    lightIndices.clear();
+    numDropped = 0;
+    unsigned int offset = 0;
+    for (int z = 0; z < clustersZ; z++) {
+        int sliceOffset = 0;
+        for (int i = 0; i < clustersPerSlice; i++) {
+            int cluster = z * clustersPerSlice + i;
+            unsigned int count = clusterGrid[cluster * 2 + 1];
+            unsigned int kept = min(count, (unsigned int) max(0, maxLightIndices - (int) offset));
+            lightIndices.insert(lightIndices.end(), sliceIndices[z].begin() + sliceOffset, sliceIndices[z].begin() + sliceOffset + kept);
+            numDropped += count - kept;
+            sliceOffset += count;
+
+            clusterGrid[cluster * 2] = offset;
+            clusterGrid[cluster * 2 + 1] = kept;
+            offset += kept;
+        }
+    }
+
+    auto finish = chrono::high_resolution_clock::now();
+    assignTime = chrono::duration_cast<chrono::microseconds>(finish - start).count();
+}
+
+void LightClusters::setMaxLightIndices(int maxLightIndices) {
+    this->maxLightIndices = maxLightIndices;
+}
+
+// Getters
+const vector<unsigned int>& LightClusters::getClusterGrid() {
+    return clusterGrid;
+}
+const vector<unsigned int>& LightClusters::getLightIndices() {
+    return lightIndices;
+}
+const vector<float>& LightClusters::getLightData() {
+    return lightData;
+}
+glm::ivec3 LightClusters::getClusterCounts() {
+    return glm::ivec3(clustersX, clustersY, clustersZ);
+}
+int LightClusters::getNumDropped() {
+    return numDropped;
+}
+long LightClusters::getAssignTime() {
+    return assignTime;
+}
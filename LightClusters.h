@@ -0,0 +1,60 @@
+#pragma once
+#include "Model.h"
+
+// Divides the view frustum into clustersX * clustersY screen tiles and clustersZ
+// exponential depth slices, and lists the point lights reaching each cluster
+class LightClusters {
+public:
+    // Point Light (world space)
+    struct PointLight {
+        PointLight(glm::vec3 position, float radius, glm::vec3 color, float intensity);
+        glm::vec3 position;
+        float radius;
+        glm::vec3 color;
+        float intensity;
+    };
+
+private:
+    int clustersX, clustersY, clustersZ;
+    int numThreads;
+
+    // Frustum the clusters were made for
+    float fov = 0;
+    float aspectRatio = 0;
+    float nearClippingPlane = 0;
+    float farClippingPlane = 0;
+
+    // View space bounding box of each cluster
+    vector<glm::vec3> clusterMin;
+    vector<glm::vec3> clusterMax;
+
+    // Results (offset/count per cluster, light indices, 8 floats per light)
+    vector<unsigned int> clusterGrid;
+    vector<unsigned int> lightIndices;
+    vector<float> lightData;
+    int maxLightIndices = 1 << 24;
+    int numDropped = 0;
+    long assignTime = 0;
+
+    int getSlice(float depth);
+    float getSliceDepth(int slice);
+
+public:
+    LightClusters(int clustersX, int clustersY, int clustersZ, int numThreads);
+
+    // Remakes the cluster bounds only when the projection changed
+    void setFrustum(float fov, float aspectRatio, float nearClippingPlane, float farClippingPlane);
+
+    // Assign lights to clusters, viewMatrix moves them into view space
+    void assign(const vector<PointLight>& lights, glm::mat4 viewMatrix);
+
+    // Limit for the index list (GL_MAX_TEXTURE_BUFFER_SIZE), lights past it are dropped
+    void setMaxLightIndices(int maxLightIndices);
+
+    const vector<unsigned int>& getClusterGrid();
+    const vector<unsigned int>& getLightIndices();
+    const vector<float>& getLightData();
+    glm::ivec3 getClusterCounts();
+    int getNumDropped();
+    long getAssignTime();
+};
@@ -1,142 +1,486 @@
 #include "Model.h"
 
-// Open an object file as a model
-Model::Model(string fileName) {
-    map<string, glm::vec3> material;
-    string currMaterial = "";
+// Parsed lines of one chunk, indices are kept as written until every chunk is read
+struct Model::ParseChunk {
+    // Vertices/Textures/Normals defined in this chunk
+    vector<Vertex*> vertices;
+    vector<VertexTexture*> vertexTextures;
+    vector<Vertex*> vertexNormals;
+
+    // Faces (corners of face i are corners[cornerOffsets[i] .. cornerOffsets[i + 1]]), with the
+    // number of v/vt/vn lines read before each face to resolve relative indices
+    vector<int> cornerOffsets = {0};
+    vector<VertexIndex> corners;
+    vector<VertexIndex> faceCounts;
+
+    // Materials (-1 keeps the material the chunk started with)
+    vector<string> materialNames;
+    vector<int> faceMaterials;
+    vector<string> materialLibraries;
+
+    // Where this chunk's definitions start in the whole file
+    VertexIndex offsets = VertexIndex(0, 0, 0);
+    string startMaterial;
+
+    // Repaired triangles, with the v/vt/vn triple of each corner
+    vector<Triangle*> triangles;
+    vector<VertexIndex> triangleCorners;
+
+    LoadStatistics statistics;
+};
+
+// Characters between tokens (\r for Windows line endings)
+static const char* skipSpaces(const char* position, const char* end) {
+    while (position < end && (*position == ' ' || *position == '\t' || *position == '\r')) {
+        position++;
+    }
+    return position;
+}
 
-    // Open the file
-    ifstream file(fileName);
+static const char* findTokenEnd(const char* position, const char* end) {
+    while (position < end && *position != ' ' && *position != '\t' && *position != '\r') {
+        position++;
+    }
+    return position;
+}
+
+// Read count floats, false if any is missing
+static bool parseFloats(const char* position, const char* end, float* values, int count) {
+    for (int i = 0; i < count; i++) {
+        position = skipSpaces(position, end);
+        char* numberEnd;
+        values[i] = strtof(position, &numberEnd);
+        if (numberEnd == position || numberEnd > end) {
+            return false;
+        }
+        position = numberEnd;
+    }
+    return true;
+}
+
+// Read a v, v/vt, v//vn or v/vt/vn corner (0 when not given)
+static bool parseCorner(const char* position, const char* end, int* indices) {
+    for (int i = 0; i < 3; i++) {
+        indices[i] = 0;
+    }
+
+    for (int i = 0; i < 3 && position < end; i++) {
+        if (*position != '/') {
+            char* numberEnd;
+            indices[i] = (int) strtol(position, &numberEnd, 10);
+            if (numberEnd == position || numberEnd > end) {
+                return false;
+            }
+            position = numberEnd;
+        }
+        if (position < end && *position == '/') {
+            position++;
+        }
+    }
+
+    return indices[0] != 0 && position == end;
+}
+
+// Open an object file as a model. The file is split into chunks at line breaks,
+// each chunk is parsed and then repaired on its own thread, and the results are
+// joined in file order so the model does not depend on the number of threads.
+Model::Model(string fileName) : Model(fileName, 0) {
+}
+
+Model::Model(string fileName, int numThreads) {
+    this->numThreads = numThreads;
+    auto start = chrono::high_resolution_clock::now();
+
+    // Read the whole file at once
+    ifstream file(fileName, ios::binary | ios::ate);
     if (!file.is_open()) {
         cout << "File: \'" + fileName + "\' failed to open." << endl;
         return;
     }
 
-    string currLine;
+    string text((size_t) file.tellg(), '\0');
+    file.seekg(0);
+    file.read(&text[0], text.size());
+    file.close();
 
-    // Read all lines
-    while (getline(file, currLine)) {
-        stringstream currLineStream(currLine);
-        vector<string> parts;
-        string currLinePart;
+    // Chunks end at line breaks, small files are one chunk
+    int threads = getNumThreads(numThreads);
+    int numChunks = max(1, min(threads, (int) (text.size() / 65536)));
+    vector<const char*> chunkStarts;
+    const char* textEnd = text.data() + text.size();
+    for (int i = 0; i < numChunks; i++) {
+        const char* chunkStart = text.data() + (size_t) ((long long) text.size() * i / numChunks);
+        if (i > 0) {
+            chunkStart = find(chunkStart, textEnd, '\n');
+            chunkStart = chunkStart == textEnd ? textEnd : chunkStart + 1;
+        }
+        chunkStarts.push_back(max(chunkStart, i > 0 ? chunkStarts.back() : chunkStart));
+    }
+    chunkStarts.push_back(textEnd);
 
-        // Read each part of the current line
-        while (getline(currLineStream, currLinePart, ' ')) {
-            parts.push_back(currLinePart);
+    vector<ParseChunk> chunks(numChunks);
+    parallelFor(numChunks, threads, [&](int first, int last) {
+        for (int i = first; i < last; i++) {
+            parseChunk(chunkStarts[i], chunkStarts[i + 1], &chunks[i]);
         }
+    });
 
-        // Use first part to decide what to do
-        if (parts.size() == 0) {
+    // Join the definitions in file order, each chunk starts with the material the previous one ended on
+    string currMaterial = "";
+    vector<string> materialLibraries;
+    for (int i = 0; i < numChunks; i++) {
+        ParseChunk* chunk = &chunks[i];
+        chunk->offsets = VertexIndex(vertices.size(), vertexTextures.size(), vertexNormals.size());
+        chunk->startMaterial = currMaterial;
+        if (!chunk->materialNames.empty()) {
+            currMaterial = chunk->materialNames.back();
+        }
+
+        vertices.insert(vertices.end(), chunk->vertices.begin(), chunk->vertices.end());
+        vertexTextures.insert(vertexTextures.end(), chunk->vertexTextures.begin(), chunk->vertexTextures.end());
+        vertexNormals.insert(vertexNormals.end(), chunk->vertexNormals.begin(), chunk->vertexNormals.end());
+        materialLibraries.insert(materialLibraries.end(), chunk->materialLibraries.begin(), chunk->materialLibraries.end());
+    }
+
+    // Material files are relative to the OBJ File, later definitions replace earlier ones
+    string directory = fileName.substr(0, fileName.find_last_of("/\\") + 1);
+    map<string, glm::vec3> material;
+    for (int i = 0; i < materialLibraries.size(); i++) {
+        materialFiles.push_back(directory + materialLibraries.at(i));
+        map<string, glm::vec3> library = readMaterial(materialFiles.back());
+        for (auto entry = library.begin(); entry != library.end(); entry++) {
+            material[entry->first] = entry->second;
+        }
+    }
+
+    parallelFor(numChunks, threads, [&](int first, int last) {
+        for (int i = first; i < last; i++) {
+            repairChunk(&chunks[i], material);
+        }
+    });
+
+    // Find or create the unique vertex of each corner in file order, marking the vertices faces use
+    unordered_map<VertexIndex, int, VertexIndexHash> uniqueVertexMap;
+    vector<char> referenced(vertices.size(), 0);
+    colors.assign(vertices.size(), defaultColor);
+    for (int i = 0; i < numChunks; i++) {
+        ParseChunk* chunk = &chunks[i];
+        for (int j = 0; j < chunk->triangles.size(); j++) {
+            Triangle* triangle = chunk->triangles[j];
+            int* uniqueCorners[3] = {&triangle->u1, &triangle->u2, &triangle->u3};
+            for (int k = 0; k < 3; k++) {
+                VertexIndex corner = chunk->triangleCorners[j * 3 + k];
+                auto found = uniqueVertexMap.find(corner);
+                if (found != uniqueVertexMap.end()) {
+                    *uniqueCorners[k] = found->second;
+                }
+                else {
+                    uniqueVertexMap.emplace(corner, uniqueVertices.size());
+                    *uniqueCorners[k] = uniqueVertices.size();
+                    uniqueVertices.push_back(corner);
+                }
+
+                // Set Vertex Colors
+                referenced[corner.vertex - 1] = 1;
+                colors[corner.vertex - 1] = triangle->color;
+            }
+        }
+        triangles.insert(triangles.end(), chunk->triangles.begin(), chunk->triangles.end());
+
+        LoadStatistics* statistics = &chunk->statistics;
+        loadStatistics.numFaces += statistics->numFaces;
+        loadStatistics.numTriangles += statistics->numTriangles;
+        loadStatistics.numRelativeIndices += statistics->numRelativeIndices;
+        loadStatistics.numInvalidLines += statistics->numInvalidLines;
+        loadStatistics.numInvalidFaces += statistics->numInvalidFaces;
+        loadStatistics.numInvalidAttributes += statistics->numInvalidAttributes;
+        loadStatistics.numDegenerateTriangles += statistics->numDegenerateTriangles;
+    }
+
+    loadStatistics.numChunks = numChunks;
+    loadStatistics.numVertices = vertices.size();
+    loadStatistics.numTextures = vertexTextures.size();
+    loadStatistics.numNormals = vertexNormals.size();
+    compactVertices(referenced);
+
+    buildVertexTriangles();
+
+    auto finish = chrono::high_resolution_clock::now();
+    loadStatistics.loadTime = chrono::duration_cast<chrono::microseconds>(finish - start).count();
+}
+
+// Parse the lines of one chunk without resolving indices
+void Model::parseChunk(const char* begin, const char* end, ParseChunk* chunk) {
+    int currMaterial = -1;
+
+    // Read all lines
+    const char* lineStart = begin;
+    while (lineStart < end) {
+        const char* lineEnd = find(lineStart, end, '\n');
+        const char* keyword = skipSpaces(lineStart, lineEnd);
+        const char* keywordEnd = findTokenEnd(keyword, lineEnd);
+        const char* rest = skipSpaces(keywordEnd, lineEnd);
+        string type(keyword, keywordEnd);
+        lineStart = lineEnd + 1;
+
+        // Use first part to decide what to do, invalid definitions are kept as NaN so later indices still line up
+        if (type.empty() || type[0] == '#') {
             continue;
         }
         // Vertex
-        else if (parts.at(0) == "v") {
-            if (parts.size() < 4) {
-                continue;
+        else if (type == "v") {
+            float values[3];
+            if (!parseFloats(rest, lineEnd, values, 3)) {
+                values[0] = values[1] = values[2] = NAN;
+                chunk->statistics.numInvalidLines++;
             }
-
-            glm::vec3 colorVec = material.count(currMaterial) != 0 ? material.at(currMaterial) : defaultColor;
-            colors.push_back(colorVec);
-            vertexTriangles.push_back({});
-            vertices.push_back(new Vertex(stof(parts.at(1)), stof(parts.at(2)), stof(parts.at(3))));
+            chunk->vertices.push_back(new Vertex(values[0], values[1], values[2]));
         }
         // Texture Vertex
-        else if (parts.at(0) == "vt") {
-            if (parts.size() < 3) {
-                continue;
+        else if (type == "vt") {
+            float values[2];
+            if (!parseFloats(rest, lineEnd, values, 2)) {
+                values[0] = values[1] = NAN;
+                chunk->statistics.numInvalidLines++;
             }
-
-            vertexTextures.push_back(new VertexTexture(stof(parts.at(1)), stof(parts.at(2))));
+            chunk->vertexTextures.push_back(new VertexTexture(values[0], values[1]));
         }
         // Normal Vertex
-        else if (parts.at(0) == "vn") {
-            if (parts.size() < 4) {
-                continue;
+        else if (type == "vn") {
+            float values[3];
+            if (!parseFloats(rest, lineEnd, values, 3)) {
+                values[0] = values[1] = values[2] = NAN;
+                chunk->statistics.numInvalidLines++;
             }
-
-            vertexNormals.push_back(new Vertex(stof(parts.at(1)), stof(parts.at(2)), stof(parts.at(3))));
+            chunk->vertexNormals.push_back(new Vertex(values[0], values[1], values[2]));
         }
         // Face
-        else if (parts.at(0) == "f") {
-            vector<int> faceVertices;
-            vector<int> faceTextures;
-            vector<int> faceNormals;
-
-            // For each part
-            for (int i = 1; i < parts.size(); i++) {
-                string currVertex;
-                stringstream currVertexStream(parts.at(i));
-                vector<string> vertexParts;
-
-                // Read each vertex
-                while (getline(currVertexStream, currVertex, '/')) {
-                    vertexParts.push_back(currVertex);
-                }
-
-                // Place into proper vector
-                if (vertexParts.size() > 0 && vertexParts.at(0) != "") {
-                    faceVertices.push_back(stoi(vertexParts.at(0)));
-                }
-                if (vertexParts.size() > 1 && vertexParts.at(1) != "") {
-                    faceTextures.push_back(stoi(vertexParts.at(1)));
-                }
-                if (vertexParts.size() > 2 && vertexParts.at(2) != "") {
-                    faceNormals.push_back(stoi(vertexParts.at(2)));
+        else if (type == "f") {
+            chunk->statistics.numFaces++;
+            int numCorners = 0;
+            bool valid = true;
+            for (const char* corner = rest; corner < lineEnd; corner = skipSpaces(corner, lineEnd)) {
+                const char* cornerEnd = findTokenEnd(corner, lineEnd);
+                int indices[3];
+                if (!parseCorner(corner, cornerEnd, indices)) {
+                    valid = false;
+                    break;
                 }
+                chunk->corners.push_back(VertexIndex(indices[0], indices[1], indices[2]));
+                numCorners++;
+                corner = cornerEnd;
             }
 
-            // Subdivide faces into triangles
-            if (faceVertices.size() >= 3) {
-                int numTriangles = faceVertices.size()  - 2;
-                for (int i = 0; i < numTriangles; i++) {
-                    int currVertex = i + 2;
-                    glm::vec3 colorVec = material.count(currMaterial) != 0 ? material.at(currMaterial) : defaultColor;
-
-                    // Resize color vector if too small
-                    if (colors.size() <= faceVertices.at(0)) {
-                        colors.resize(faceVertices.at(0) - 1 + 1);
-                    }
-                    if (colors.size() <= faceVertices.at(currVertex - 1)) {
-                        colors.resize(faceVertices.at(currVertex - 1) - 1 + 1);
-                    }
-                    if (colors.size() <= faceVertices.at(currVertex)) {
-                        colors.resize(faceVertices.at(currVertex) - 1 + 1);
-                    }
-
-                    // Set Vertex Colors
-                    colors.at(faceVertices.at(0) - 1) = colorVec;
-                    colors.at(faceVertices.at(currVertex - 1) - 1) = colorVec;
-                    colors.at(faceVertices.at(currVertex) - 1) = colorVec;
-
-                    Triangle* triPtr = new Triangle(faceVertices.at(0), faceVertices.at(currVertex - 1), faceVertices.at(currVertex), colorVec);
-
-                    vertexTriangles.at(faceVertices.at(0) - 1).push_back(triPtr);
-                    vertexTriangles.at(faceVertices.at(currVertex - 1) - 1).push_back(triPtr);
-                    vertexTriangles.at(faceVertices.at(currVertex) - 1).push_back(triPtr);
-
-                    triangles.push_back(triPtr);
-                }
+            if (!valid || numCorners < 3) {
+                chunk->corners.erase(chunk->corners.end() - numCorners, chunk->corners.end());
+                chunk->statistics.numInvalidFaces++;
+                continue;
             }
+
+            chunk->cornerOffsets.push_back(chunk->corners.size());
+            chunk->faceCounts.push_back(VertexIndex(chunk->vertices.size(), chunk->vertexTextures.size(), chunk->vertexNormals.size()));
+            chunk->faceMaterials.push_back(currMaterial);
         }
         // Read a material library
-        else if (parts.at(0) == "mtllib") {
-            if (parts.size() < 2) {
+        else if (type == "mtllib") {
+            if (rest == lineEnd) {
                 continue;
             }
 
-            material = readMaterial(parts.at(1));
+            chunk->materialLibraries.push_back(string(rest, findTokenEnd(rest, lineEnd)));
         }
         // Change current material
-        else if (parts.at(0) == "usemtl") {
-            if (parts.size() < 2) {
+        else if (type == "usemtl") {
+            if (rest == lineEnd) {
                 continue;
             }
 
-            currMaterial = parts.at(1);
+            currMaterial = chunk->materialNames.size();
+            chunk->materialNames.push_back(string(rest, findTokenEnd(rest, lineEnd)));
         }
     }
+}
 
-    file.close();
+// Resolve indices, drop faces with invalid vertices and invalid texture/normal indices,
+// triangulate, and drop degenerate triangles. Reads only the joined definitions.
+void Model::repairChunk(ParseChunk* chunk, const map<string, glm::vec3>& material) {
+    // Color of each material name (the last is the start material)
+    vector<glm::vec3> materialColors;
+    chunk->materialNames.push_back(chunk->startMaterial);
+    for (int i = 0; i < chunk->materialNames.size(); i++) {
+        auto found = material.find(chunk->materialNames.at(i));
+        materialColors.push_back(found != material.end() ? found->second : defaultColor);
+    }
+
+    // Relative indices count back from the definitions before the face
+    int totals[3] = {(int) vertices.size(), (int) vertexTextures.size(), (int) vertexNormals.size()};
+    auto resolve = [&](int index, int offset, int count, int total) {
+        if (index < 0) {
+            chunk->statistics.numRelativeIndices++;
+            index = offset + count + index + 1;
+        }
+        return index >= 1 && index <= total ? index : 0;
+    };
+
+    for (int i = 0; i + 1 < chunk->cornerOffsets.size(); i++) {
+        VertexIndex counts = chunk->faceCounts[i];
+        int first = chunk->cornerOffsets[i];
+        int last = chunk->cornerOffsets[i + 1];
+
+        bool valid = true;
+        for (int j = first; j < last; j++) {
+            VertexIndex* corner = &chunk->corners[j];
+            corner->vertex = resolve(corner->vertex, chunk->offsets.vertex, counts.vertex, totals[0]);
+            valid = valid && corner->vertex != 0;
+
+            // Missing or unusable textures/normals are dropped from the corner
+            int texture = resolve(corner->texture, chunk->offsets.texture, counts.texture, totals[1]);
+            int normal = resolve(corner->normal, chunk->offsets.normal, counts.normal, totals[2]);
+            if (normal != 0) {
+                Vertex* fileNormal = vertexNormals[normal - 1];
+                normal = fileNormal->x * fileNormal->x + fileNormal->y * fileNormal->y + fileNormal->z * fileNormal->z > 0 ? normal : 0;
+            }
+            if ((corner->texture != 0 && texture == 0) || (corner->normal != 0 && normal == 0)) {
+                chunk->statistics.numInvalidAttributes++;
+            }
+            corner->texture = texture;
+            corner->normal = normal;
+        }
+
+        if (!valid) {
+            chunk->statistics.numInvalidFaces++;
+            continue;
+        }
+
+        int materialIndex = chunk->faceMaterials[i] >= 0 ? chunk->faceMaterials[i] : materialColors.size() - 1;
+        glm::vec3 colorVec = materialColors.at(materialIndex);
+
+        // Subdivide faces into triangles, skipping ones without area (NaN positions fail the test too)
+        for (int j = first + 1; j + 1 < last; j++) {
+            VertexIndex cornerOne = chunk->corners[first];
+            VertexIndex cornerTwo = chunk->corners[j];
+            VertexIndex cornerThree = chunk->corners[j + 1];
+
+            Vertex* one = vertices[cornerOne.vertex - 1];
+            Vertex* two = vertices[cornerTwo.vertex - 1];
+            Vertex* three = vertices[cornerThree.vertex - 1];
+            glm::vec3 u = glm::vec3(two->x - one->x, two->y - one->y, two->z - one->z);
+            glm::vec3 w = glm::vec3(three->x - one->x, three->y - one->y, three->z - one->z);
+            glm::vec3 cross = glm::cross(u, w);
+            float crossLength = glm::dot(cross, cross);
+            if (!(crossLength > 1e-12f * glm::dot(u, u) * glm::dot(w, w))) {
+                chunk->statistics.numDegenerateTriangles++;
+                continue;
+            }
+
+            chunk->triangles.push_back(new Triangle(cornerOne.vertex, cornerTwo.vertex, cornerThree.vertex, 0, 0, 0, colorVec));
+            chunk->triangleCorners.push_back(cornerOne);
+            chunk->triangleCorners.push_back(cornerTwo);
+            chunk->triangleCorners.push_back(cornerThree);
+            chunk->statistics.numTriangles++;
+        }
+    }
+}
+
+// Remove vertices no triangle uses, renumbering the triangles and unique vertices
+void Model::compactVertices(const vector<char>& referenced) {
+    vector<int> newIndex(vertices.size(), 0);
+    int numKept = 0;
+    for (int i = 0; i < vertices.size(); i++) {
+        if (referenced[i]) {
+            vertices[numKept] = vertices[i];
+            colors[numKept] = colors[i];
+            newIndex[i] = ++numKept;
+        }
+        else {
+            delete vertices[i];
+        }
+    }
+
+    loadStatistics.numUnreferencedVertices = vertices.size() - numKept;
+    if (numKept == vertices.size()) {
+        return;
+    }
+
+    vertices.resize(numKept);
+    colors.resize(numKept);
+    for (int i = 0; i < triangles.size(); i++) {
+        triangles[i]->p1 = newIndex[triangles[i]->p1 - 1];
+        triangles[i]->p2 = newIndex[triangles[i]->p2 - 1];
+        triangles[i]->p3 = newIndex[triangles[i]->p3 - 1];
+    }
+    for (int i = 0; i < uniqueVertices.size(); i++) {
+        uniqueVertices[i].vertex = newIndex[uniqueVertices[i].vertex - 1];
+    }
+}
+
+// Empty model for generators
+Model::Model() {
+}
+
+// Generate a grid in the XY plane with a wave along Z
+Model* Model::generateGrid(int columns, int rows) {
+    Model* model = new Model();
+    model->vertices.reserve((columns + 1) * (rows + 1));
+    model->colors.reserve((columns + 1) * (rows + 1));
+    model->uniqueVertices.reserve((columns + 1) * (rows + 1));
+    model->triangles.reserve(2 * columns * rows);
+
+    // Vertices (OBJ style, indices start at 1)
+    for (int y = 0; y <= rows; y++) {
+        for (int x = 0; x <= columns; x++) {
+            float u = (float) x / columns;
+            float v = (float) y / rows;
+            model->vertices.push_back(new Vertex(u * 2 - 1, v * 2 - 1, 0.1f * sin(u * 20) * cos(v * 20)));
+            model->colors.push_back(model->defaultColor);
+            model->uniqueVertices.push_back(VertexIndex(model->vertices.size(), 0, 0));
+        }
+    }
+
+    // Two triangles per cell
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < columns; x++) {
+            int corner = y * (columns + 1) + x;
+            int right = corner + 1;
+            int above = corner + columns + 1;
+            int aboveRight = above + 1;
+            model->triangles.push_back(new Triangle(corner + 1, right + 1, aboveRight + 1, corner, right, aboveRight, model->defaultColor));
+            model->triangles.push_back(new Triangle(corner + 1, aboveRight + 1, above + 1, corner, aboveRight, above, model->defaultColor));
+        }
+    }
+
+    model->buildVertexTriangles();
+    return model;
+}
+
+// Counting sort of triangle corners by vertex, so each vertex lists its triangles in order
+void Model::buildVertexTriangles() {
+    vertexTriangleOffsets.assign(vertices.size() + 1, 0);
+    for (int i = 0; i < triangles.size(); i++) {
+        int corners[3] = {triangles[i]->p1, triangles[i]->p2, triangles[i]->p3};
+        for (int j = 0; j < 3; j++) {
+            if (corners[j] >= 1 && corners[j] <= vertices.size()) {
+                vertexTriangleOffsets[corners[j]]++;
+            }
+        }
+    }
+
+    for (int i = 0; i < vertices.size(); i++) {
+        vertexTriangleOffsets[i + 1] += vertexTriangleOffsets[i];
+    }
+
+    vector<int> position(vertexTriangleOffsets.begin(), vertexTriangleOffsets.end() - 1);
+    vertexTriangleIndices.resize(vertexTriangleOffsets.back());
+    for (int i = 0; i < triangles.size(); i++) {
+        int corners[3] = {triangles[i]->p1, triangles[i]->p2, triangles[i]->p3};
+        for (int j = 0; j < 3; j++) {
+            if (corners[j] >= 1 && corners[j] <= vertices.size()) {
+                vertexTriangleIndices[position[corners[j] - 1]++] = i;
+            }
+        }
+    }
+
+    smoothNormals.clear();
 }
 
 // Destructor
@@ -161,13 +505,8 @@ Model::~Model() {
 }
 
 // Generate VBO Vertices
-float * Model::generateVBOVerticesArray(bool cpuMatrix, bool colorModifier, bool triangleNormal, bool useNormal) {
-    // Matrix to use (either identity if using gpuMatrix, or cpuMatrix)
-    glm::mat4 matrix = glm::mat4(1);
-    if (cpuMatrix) {
-        matrix = getMatrix();
-    }
-
+// Matrix is applied on the CPU (identity if using gpuMatrix)
+float * Model::generateVBOVerticesArray(glm::mat4 matrix, bool colorModifier, bool triangleNormal, bool useNormal) {
     // Generate the array
     float* vertexArray = new float[triangles.size() * 3 * 11];
     for (int i = 0; i < triangles.size(); i++) {
@@ -184,7 +523,7 @@ float * Model::generateVBOVerticesArray(bool cpuMatrix, bool colorModifier, bool
         vertexArray[index + 5] = color.y * colorModifierVal;
         vertexArray[index + 6] = color.z * colorModifierVal;
         vertexArray[index + 7] = 1.0f;
-        glm::vec3 normal = useNormal ? glm::normalize(glm::vec3(matrix * glm::vec4(getNormal(triangleNormal ? i : vertexOneIndex, triangleNormal), 0))) : glm::vec3(0, 0, 0);
+        glm::vec3 normal = useNormal ? glm::normalize(glm::vec3(matrix * glm::vec4((triangleNormal ? getNormal(i, true) : getUniqueVertexNormal(triangles.at(i)->u1)), 0))) : glm::vec3(0, 0, 0);
         vertexArray[index + 8] = normal.x;
         vertexArray[index + 9] = normal.y;
         vertexArray[index + 10] = normal.z;
@@ -199,7 +538,7 @@ float * Model::generateVBOVerticesArray(bool cpuMatrix, bool colorModifier, bool
         vertexArray[index + 16] = color.y * colorModifierVal;
         vertexArray[index + 17] = color.z * colorModifierVal;
         vertexArray[index + 18] = 1.0f;
-        normal = useNormal ? glm::normalize(glm::vec3(matrix * glm::vec4(getNormal(triangleNormal ? i : vertexTwoIndex, triangleNormal), 0))) : glm::vec3(0, 0, 0);
+        normal = useNormal ? glm::normalize(glm::vec3(matrix * glm::vec4((triangleNormal ? getNormal(i, true) : getUniqueVertexNormal(triangles.at(i)->u2)), 0))) : glm::vec3(0, 0, 0);
         vertexArray[index + 19] = normal.x;
         vertexArray[index + 20] = normal.y;
         vertexArray[index + 21] = normal.z;
@@ -214,7 +553,7 @@ float * Model::generateVBOVerticesArray(bool cpuMatrix, bool colorModifier, bool
         vertexArray[index + 27] = color.y * colorModifierVal;
         vertexArray[index + 28] = color.z * colorModifierVal;
         vertexArray[index + 29] = 1.0f;
-        normal = useNormal ? glm::normalize(glm::vec3(matrix * glm::vec4(getNormal(triangleNormal ? i : vertexThreeIndex, triangleNormal), 0))) : glm::vec3(0, 0, 0);
+        normal = useNormal ? glm::normalize(glm::vec3(matrix * glm::vec4((triangleNormal ? getNormal(i, true) : getUniqueVertexNormal(triangles.at(i)->u3)), 0))) : glm::vec3(0, 0, 0);
         vertexArray[index + 30] = normal.x;
         vertexArray[index + 31] = normal.y;
         vertexArray[index + 32] = normal.z;
@@ -225,18 +564,26 @@ float * Model::generateVBOVerticesArray(bool cpuMatrix, bool colorModifier, bool
 
 // Number of vertices based on mode
 int Model::getNumVertices(bool useEBO) {
-    return useEBO ? vertices.size() : triangles.size() * 3;
+    return useEBO ? uniqueVertices.size() : triangles.size() * 3;
 }
 
 // Generate model view projection matrix
 glm::mat4 Model::generateModelMatrix() {
-    glm::mat4 translationMatrix = glm::translate(glm::mat4(1), translate);
-    glm::mat4 rotationMatrixX = glm::rotate(angleX, glm::vec3(1, 0, 0));
-    glm::mat4 rotationMatrixY = glm::rotate(angleY, glm::vec3(0, 1, 0));
-    glm::mat4 rotationMatrixZ = glm::rotate(angleZ, glm::vec3(0, 0, 1));
-    glm::mat4 scaleMatrix = glm::scale(glm::mat4(1), scale);
+    return generateModelMatrix(translate, glm::vec3(angleX, angleY, angleZ), scale);
+}
 
-    return translationMatrix * rotationMatrixZ * rotationMatrixY * rotationMatrixX * scaleMatrix;
+// Translation * RotationZ * RotationY * RotationX * Scale written out directly
+glm::mat4 Model::generateModelMatrix(glm::vec3 translate, glm::vec3 angles, glm::vec3 scale) {
+    float cx = cos(angles.x), sx = sin(angles.x);
+    float cy = cos(angles.y), sy = sin(angles.y);
+    float cz = cos(angles.z), sz = sin(angles.z);
+
+    glm::mat4 matrix = glm::mat4(1);
+    matrix[0] = glm::vec4(cz * cy, sz * cy, -sy, 0) * scale.x;
+    matrix[1] = glm::vec4(cz * sy * sx - sz * cx, sz * sy * sx + cz * cx, cy * sx, 0) * scale.y;
+    matrix[2] = glm::vec4(cz * sy * cx + sz * sx, sz * sy * cx - cz * sx, cy * cx, 0) * scale.z;
+    matrix[3] = glm::vec4(translate, 1);
+    return matrix;
 }
 
 // Use GLM Library to make View Matrix
@@ -246,7 +593,6 @@ glm::mat4 Model::generateViewMatrix() {
 
 // Use GLM Library to make Projection Matrix
 glm::mat4 Model::generateProjectionMatrix() {
-    glm::mat4 mat = glm::perspective(glm::radians(fov), aspectRatio, nearClippingPlane, farClippingPlane);
     return glm::perspective(glm::radians(fov), aspectRatio, nearClippingPlane, farClippingPlane);
 }
 
@@ -308,20 +654,16 @@ map<string, glm::vec3> Model::readMaterial(string fileName) {
 }
 
 // Generate EBO Vertices
-pair<float*, unsigned int*> Model::generateEBOVerticesArray(bool cpuMatrix, bool colorModifier, bool useNormal) {
-    // Matrix to use (either identity if using gpuMatrix, or cpuMatrix)
-    glm::mat4 matrix = glm::mat4(1);
-    if (cpuMatrix) {
-        matrix = getMatrix();
-    }
-
-    // Generate Vertices Array
-    float* vertexArray = new float[vertices.size() * 11];
-    for (int i = 0; i < vertices.size(); i++) {
+// Matrix is applied on the CPU (identity if using gpuMatrix)
+pair<float*, unsigned int*> Model::generateEBOVerticesArray(glm::mat4 matrix, bool colorModifier, bool useNormal) {
+    // Generate Vertices Array (one per unique v/vt/vn triple)
+    float* vertexArray = new float[uniqueVertices.size() * 11];
+    for (int i = 0; i < uniqueVertices.size(); i++) {
         int index = i * 11;
-        glm::vec3 color = colors.at(i);
-        float colorModifierVal = colorModifier ? (float) i / (float) (vertices.size() - 1) : 1;
-        glm::vec4 vertex = matrix * glm::vec4(vertices.at(i)->x, vertices.at(i)->y, vertices.at(i)->z, 1);
+        int vertexIndex = uniqueVertices.at(i).vertex - 1;
+        glm::vec3 color = colors.at(vertexIndex);
+        float colorModifierVal = colorModifier ? (float) i / (float) (uniqueVertices.size() - 1) : 1;
+        glm::vec4 vertex = matrix * glm::vec4(vertices.at(vertexIndex)->x, vertices.at(vertexIndex)->y, vertices.at(vertexIndex)->z, 1);
         vertexArray[index] = vertex.x;
         vertexArray[index + 1] = vertex.y;
         vertexArray[index + 2] = vertex.z;
@@ -330,7 +672,7 @@ pair<float*, unsigned int*> Model::generateEBOVerticesArray(bool cpuMatrix, bool
         vertexArray[index + 5] = color.y * colorModifierVal;
         vertexArray[index + 6] = color.z * colorModifierVal;
         vertexArray[index + 7] = 1.0f;
-        glm::vec3 normal = useNormal ? glm::normalize(glm::vec3(matrix * glm::vec4(getNormal(i, false), 0))) : glm::vec3(0, 0, 0);
+        glm::vec3 normal = useNormal ? glm::normalize(glm::vec3(matrix * glm::vec4(getUniqueVertexNormal(i), 0))) : glm::vec3(0, 0, 0);
         vertexArray[index + 8] = normal.x;
         vertexArray[index + 9] = normal.y;
         vertexArray[index + 10] = normal.z;
@@ -340,9 +682,9 @@ pair<float*, unsigned int*> Model::generateEBOVerticesArray(bool cpuMatrix, bool
     unsigned int* indexArray = new unsigned int[triangles.size() * 3];
     for (int i = 0; i < triangles.size(); i++) {
         int index = i * 3;
-        indexArray[index] = triangles.at(i)->p1 - 1;
-        indexArray[index + 1] = triangles.at(i)->p2 - 1;
-        indexArray[index + 2] = triangles.at(i)->p3 - 1;
+        indexArray[index] = triangles.at(i)->u1;
+        indexArray[index + 1] = triangles.at(i)->u2;
+        indexArray[index + 2] = triangles.at(i)->u3;
     }
 
     return {vertexArray, indexArray};
@@ -358,34 +700,30 @@ Model::VertexTexture::VertexTexture(float x, float y) {
     this->x = x;
     this->y = y;
 }
-Model::Triangle::Triangle(int p1, int p2, int p3, glm::vec3 color) {
+Model::Triangle::Triangle(int p1, int p2, int p3, int u1, int u2, int u3, glm::vec3 color) {
     this->p1 = p1;
     this->p2 = p2;
     this->p3 = p3;
+    this->u1 = u1;
+    this->u2 = u2;
+    this->u3 = u3;
     this->color = color;
 }
+Model::VertexIndex::VertexIndex(int vertex, int texture, int normal) {
+    this->vertex = vertex;
+    this->texture = texture;
+    this->normal = normal;
+}
 
-// Read a Shader File
-char* Model::readShader(string fileName) {
-    // Open the File
-    ifstream shader(fileName);
-    if (!shader.is_open()) {
-        cout << "File: \'" << fileName << "\' failed to open." << endl;
-    }
-
-    // Convert to a string
-    stringstream stream;
-    stream << shader.rdbuf();
-    string shaderString = stream.str();
-    char* shaderArray = new char[shaderString.size() + 1];
-    for (int i = 0; i < shaderString.size(); i++) {
-        shaderArray[i] = shaderString.at(i);
-    }
-    shaderArray[shaderString.size()] = '\0';
-
-    shader.close();
-
-    return shaderArray;
+// Index Triple Comparison/Hash
+bool Model::VertexIndex::operator==(const VertexIndex& other) const {
+    return vertex == other.vertex && texture == other.texture && normal == other.normal;
+}
+size_t Model::VertexIndexHash::operator()(const VertexIndex& index) const {
+    size_t seed = hash<int>()(index.vertex);
+    seed ^= hash<int>()(index.texture) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    seed ^= hash<int>()(index.normal) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    return seed;
 }
 
 // Number of indices
@@ -393,6 +731,23 @@ int Model::getNumIndices() {
     return triangles.size() * 3;
 }
 
+// Number of OBJ vertex positions (v lines)
+int Model::getNumPositions() {
+    return vertices.size();
+}
+
+// Position index (0 based) of each triangle corner, three per triangle
+vector<int> Model::getTriangleVertices() {
+    vector<int> triangleVertices(triangles.size() * 3);
+    for (int i = 0; i < triangles.size(); i++) {
+        triangleVertices[i * 3] = triangles[i]->p1 - 1;
+        triangleVertices[i * 3 + 1] = triangles[i]->p2 - 1;
+        triangleVertices[i * 3 + 2] = triangles[i]->p3 - 1;
+    }
+
+    return triangleVertices;
+}
+
 glm::vec3 Model::calculateTriangleNormal(Triangle* triangle) {
     Vertex* pointOneVertex = vertices.at(triangle->p1 - 1);
     glm::vec3 pointOne = glm::vec3(pointOneVertex->x, pointOneVertex->y, pointOneVertex->z);
@@ -410,28 +765,108 @@ glm::vec3 Model::calculateTriangleNormal(Triangle* triangle) {
 
 glm::vec3 Model::getNormal(int number, bool triangleNormal) {
     if (triangleNormal) {
-        Vertex* pointOneVertex = vertices.at(triangles.at(number)->p1 - 1);
-        glm::vec3 pointOne = glm::vec3(pointOneVertex->x, pointOneVertex->y, pointOneVertex->z);
-        Vertex* pointTwoVertex = vertices.at(triangles.at(number)->p2 - 1);
-        glm::vec3 pointTwo = glm::vec3(pointTwoVertex->x, pointTwoVertex->y, pointTwoVertex->z);
-        Vertex* pointThreeVertex = vertices.at(triangles.at(number)->p3 - 1);
-        glm::vec3 pointThree = glm::vec3(pointThreeVertex->x, pointThreeVertex->y, pointThreeVertex->z);
-
-        glm::vec3 u = pointTwo - pointOne;
-        glm::vec3 w = pointThree - pointTwo;
-
-        glm::vec3 normal = glm::normalize(glm::cross(u, w));
         return calculateTriangleNormal(triangles.at(number));
     }
     else {
-        glm::vec3 average(0, 0, 0);
+        if (smoothNormals.empty()) {
+            computeSmoothNormals(numThreads);
+        }
 
-        for (int i = 0; i < vertexTriangles.at(number).size(); i++) {
-            average += calculateTriangleNormal(vertexTriangles.at(number).at(i));
+        return smoothNormals.at(number);
+    }
+}
+
+// Average the unit face normals around each vertex. Face normals are calculated
+// in parallel, then each thread gathers its own vertices from the CSR lists in
+// triangle order, so there are no shared writes and the sums do not depend on
+// the number of threads.
+void Model::computeSmoothNormals(int numThreads) {
+    faceNormals.resize(triangles.size());
+    smoothNormals.resize(vertices.size());
+
+    parallelFor(triangles.size(), numThreads, [this](int start, int end) {
+        for (int i = start; i < end; i++) {
+            faceNormals[i] = calculateTriangleNormal(triangles[i]);
         }
+    });
+
+    parallelFor(vertices.size(), numThreads, [this](int start, int end) {
+        for (int i = start; i < end; i++) {
+            glm::vec3 average(0, 0, 0);
+            int first = vertexTriangleOffsets[i];
+            int last = vertexTriangleOffsets[i + 1];
+            for (int j = first; j < last; j++) {
+                average += faceNormals[vertexTriangleIndices[j]];
+            }
 
-        average /= vertexTriangles.at(number).size();
+            if (last > first) {
+                average /= last - first;
+            }
 
-        return average;
+            smoothNormals[i] = average;
+        }
+    });
+}
+
+// Normal of a unique vertex, from the OBJ File if given, otherwise computed
+glm::vec3 Model::getUniqueVertexNormal(int number) {
+    VertexIndex index = uniqueVertices.at(number);
+    if (useFileNormals && index.normal > 0 && index.normal <= vertexNormals.size()) {
+        Vertex* normal = vertexNormals.at(index.normal - 1);
+        return glm::vec3(normal->x, normal->y, normal->z);
+    }
+
+    return getNormal(index.vertex - 1, false);
+}
+
+// What loading the OBJ File read and repaired
+LoadStatistics Model::getLoadStatistics() {
+    return loadStatistics;
+}
+
+vector<string> Model::getMaterialFiles() {
+    return materialFiles;
+}
+
+// Smallest/largest corner of all vertices
+pair<glm::vec3, glm::vec3> Model::getBoundingBox() {
+    if (vertices.empty()) {
+        return {glm::vec3(0, 0, 0), glm::vec3(0, 0, 0)};
     }
+
+    glm::vec3 boundsMin(vertices.at(0)->x, vertices.at(0)->y, vertices.at(0)->z);
+    glm::vec3 boundsMax = boundsMin;
+    for (int i = 1; i < vertices.size(); i++) {
+        glm::vec3 vertex(vertices[i]->x, vertices[i]->y, vertices[i]->z);
+        boundsMin = glm::min(boundsMin, vertex);
+        boundsMax = glm::max(boundsMax, vertex);
+    }
+
+    return {boundsMin, boundsMax};
+}
+
+// Corners of the largest triangles, three positions per triangle
+vector<glm::vec3> Model::getOccluderTriangles(int maxTriangles) {
+    vector<pair<float, int>> areas;
+    areas.reserve(triangles.size());
+    for (int i = 0; i < triangles.size(); i++) {
+        glm::vec3 pointOne(vertices.at(triangles[i]->p1 - 1)->x, vertices.at(triangles[i]->p1 - 1)->y, vertices.at(triangles[i]->p1 - 1)->z);
+        glm::vec3 pointTwo(vertices.at(triangles[i]->p2 - 1)->x, vertices.at(triangles[i]->p2 - 1)->y, vertices.at(triangles[i]->p2 - 1)->z);
+        glm::vec3 pointThree(vertices.at(triangles[i]->p3 - 1)->x, vertices.at(triangles[i]->p3 - 1)->y, vertices.at(triangles[i]->p3 - 1)->z);
+        areas.push_back({glm::length(glm::cross(pointTwo - pointOne, pointThree - pointOne)), i});
+    }
+
+    int numTriangles = min(maxTriangles, (int) areas.size());
+    partial_sort(areas.begin(), areas.begin() + numTriangles, areas.end(), greater<pair<float, int>>());
+
+    vector<glm::vec3> occluders;
+    occluders.reserve(numTriangles * 3);
+    for (int i = 0; i < numTriangles; i++) {
+        Triangle* triangle = triangles.at(areas.at(i).second);
+        occluders.push_back(glm::vec3(vertices.at(triangle->p1 - 1)->x, vertices.at(triangle->p1 - 1)->y, vertices.at(triangle->p1 - 1)->z));
+        occluders.push_back(glm::vec3(vertices.at(triangle->p2 - 1)->x, vertices.at(triangle->p2 - 1)->y, vertices.at(triangle->p2 - 1)->z));
+        occluders.push_back(glm::vec3(vertices.at(triangle->p3 - 1)->x, vertices.at(triangle->p3 - 1)->y, vertices.at(triangle->p3 - 1)->z));
+    }
+
+    return occluders;
 }
@@ -4,13 +4,37 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <cstdlib>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/mat4x4.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include <map>
+#include <unordered_map>
+#include "Parallel.h"
 using namespace std;
 
+// What loading an OBJ File read and repaired (times in microseconds)
+struct LoadStatistics {
+    int numChunks = 0;
+    int numVertices = 0;
+    int numTextures = 0;
+    int numNormals = 0;
+    int numFaces = 0;
+    int numTriangles = 0;
+    int numRelativeIndices = 0;
+    int numInvalidLines = 0;
+    int numInvalidFaces = 0;
+    int numInvalidAttributes = 0;
+    int numDegenerateTriangles = 0;
+    int numUnreferencedVertices = 0;
+    long loadTime = 0;
+};
+
 class Model {
     // 3D Vertex (for Vertices and Normals)
     struct Vertex {
@@ -24,30 +48,70 @@ class Model {
         float x, y;
     };
 
-    // Triangle
+    // OBJ v/vt/vn Index Triple of a Face Corner (0 if not given)
+    struct VertexIndex {
+        VertexIndex(int vertex, int texture, int normal);
+        int vertex, texture, normal;
+        bool operator==(const VertexIndex& other) const;
+    };
+
+    // Hash for Index Triples
+    struct VertexIndexHash {
+        size_t operator()(const VertexIndex& index) const;
+    };
+
+    // Triangle (p = OBJ vertex indices, u = unique vertex indices)
     struct Triangle {
-        Triangle(int p1, int p2, int p3, glm::vec3 color);
+        Triangle(int p1, int p2, int p3, int u1, int u2, int u3, glm::vec3 color);
         int p1, p2, p3;
+        int u1, u2, u3;
         glm::vec3 color;
     };
 
     // Stored vertices/triangles of model
     vector<Vertex*> vertices;
-    vector<vector<Triangle*>> vertexTriangles;
     vector<glm::vec3> colors;
     vector<Triangle*> triangles;
 
-    // Unused from OBJ File
+    // Triangles around each vertex (CSR, triangles of vertex i are
+    // vertexTriangleIndices[vertexTriangleOffsets[i] .. vertexTriangleOffsets[i + 1]])
+    vector<int> vertexTriangleOffsets;
+    vector<int> vertexTriangleIndices;
+
+    // Calculated Normals
+    vector<glm::vec3> faceNormals;
+    vector<glm::vec3> smoothNormals;
+
+    // Normals/Textures from OBJ File
     vector<Vertex*> vertexNormals;
     vector<VertexTexture*> vertexTextures;
 
+    // Unique v/vt/vn combinations used by faces (EBO Vertices)
+    vector<VertexIndex> uniqueVertices;
+
+    LoadStatistics loadStatistics;
+
+    // Material files of mtllib lines, relative to the working directory
+    vector<string> materialFiles;
+
+    // Lines of one part of an OBJ File, parsed on its own thread
+    struct ParseChunk;
+
     // Generate ModelViewProjection Matrix
     glm::mat4 generateModelMatrix();
     glm::mat4 generateViewMatrix();
     glm::mat4 generateProjectionMatrix();
 
+    // Generated models fill in their own data
+    Model();
+
+    void buildVertexTriangles();
+    void parseChunk(const char* begin, const char* end, ParseChunk* chunk);
+    void repairChunk(ParseChunk* chunk, const map<string, glm::vec3>& material);
+    void compactVertices(const vector<char>& referenced);
     map<string, glm::vec3> readMaterial(string fileName);
     glm::vec3 calculateTriangleNormal(Triangle* triangle);
+    glm::vec3 getUniqueVertexNormal(int number);
 
 public:
     // Model Matrix
@@ -70,17 +134,33 @@ public:
 
     glm::vec3 defaultColor = glm::vec3(1, 0, 1);
 
+    // Use normals from the OBJ File when present instead of computing them
+    bool useFileNormals = true;
+
+    // Threads for loading and normal calculation (0 for one per hardware thread)
+    int numThreads = 0;
+
     // Constructor/Destructor
     Model(string fileName);
+    Model(string fileName, int numThreads);
     ~Model();
 
-    static char* readShader(string fileName);
+    // Wavy grid of 2 * columns * rows triangles
+    static Model* generateGrid(int columns, int rows);
 
     glm::mat4 getMatrix();
+    static glm::mat4 generateModelMatrix(glm::vec3 translate, glm::vec3 angles, glm::vec3 scale);
 
-    float *generateVBOVerticesArray(bool cpuMatrix, bool colorModifier, bool triangleNormal, bool useNormal);
-    pair<float*, unsigned int*> generateEBOVerticesArray(bool cpuMatrix, bool colorModifier, bool useNormal);
+    float *generateVBOVerticesArray(glm::mat4 matrix, bool colorModifier, bool triangleNormal, bool useNormal);
+    pair<float*, unsigned int*> generateEBOVerticesArray(glm::mat4 matrix, bool colorModifier, bool useNormal);
     int getNumVertices(bool useEBO);
     int getNumIndices();
+    int getNumPositions();
+    vector<int> getTriangleVertices();
     glm::vec3 getNormal(int number, bool triangleNormal);
+    pair<glm::vec3, glm::vec3> getBoundingBox();
+    LoadStatistics getLoadStatistics();
+    vector<string> getMaterialFiles();
+    vector<glm::vec3> getOccluderTriangles(int maxTriangles);
+    void computeSmoothNormals(int numThreads);
 };
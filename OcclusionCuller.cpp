@@ -0,0 +1,260 @@
+#include "OcclusionCuller.h"
+#include <chrono>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OCCLUSION_CULLER_SSE2
+#endif
+
+// Constructor
+OcclusionCuller::OcclusionCuller(int width, int height) {
+    tilesX = max(1, (width + tileSize - 1) / tileSize);
+    tilesY = max(1, (height + tileSize - 1) / tileSize);
+    this->width = tilesX * tileSize;
+    this->height = tilesY * tileSize;
+    depth.resize(this->width * this->height);
+    tileMaxDepth.resize(tilesX * tilesY);
+    clear();
+}
+
+// Reset to far
+void OcclusionCuller::clear() {
+    fill(depth.begin(), depth.end(), 1.0f);
+    fill(tileMaxDepth.begin(), tileMaxDepth.end(), 1.0f);
+}
+
+// Clip space to pixel x/y and [0, 1] depth
+glm::vec3 OcclusionCuller::toScreen(glm::vec4 clip) {
+    return glm::vec3((clip.x / clip.w * 0.5f + 0.5f) * width, (clip.y / clip.w * 0.5f + 0.5f) * height, clip.z / clip.w * 0.5f + 0.5f);
+}
+
+// Rasterize triangles (three positions each) transformed by a model view projection matrix
+void OcclusionCuller::addOccluders(const vector<glm::vec3>& triangles, glm::mat4 matrix) {
+    auto start = chrono::high_resolution_clock::now();
+
+    for (int i = 0; i + 2 < triangles.size(); i += 3) {
+        glm::vec4 pointOne = matrix * glm::vec4(triangles[i], 1);
+        glm::vec4 pointTwo = matrix * glm::vec4(triangles[i + 1], 1);
+        glm::vec4 pointThree = matrix * glm::vec4(triangles[i + 2], 1);
+        rasterizeTriangle(pointOne, pointTwo, pointThree);
+    }
+
+    auto finish = chrono::high_resolution_clock::now();
+    rasterizeTime += chrono::duration_cast<chrono::microseconds>(finish - start).count();
+}
+
+// Write the nearest depth of pixels whose centers are inside the triangle
+void OcclusionCuller::rasterizeTriangle(glm::vec4 pointOne, glm::vec4 pointTwo, glm::vec4 pointThree) {
+    // Skipping triangles through the near plane only loses occlusion, never hides anything
+    float nearW = 1e-5f;
+    if (pointOne.w <= nearW || pointTwo.w <= nearW || pointThree.w <= nearW) {
+        return;
+    }
+
+    glm::vec3 a = toScreen(pointOne);
+    glm::vec3 b = toScreen(pointTwo);
+    glm::vec3 c = toScreen(pointThree);
+
+    // Both windings are occluders
+    float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (area == 0) {
+        return;
+    }
+    if (area < 0) {
+        swap(b, c);
+        area = -area;
+    }
+
+    int minX = max(0, (int) floor(min(a.x, min(b.x, c.x))));
+    int maxX = min(width - 1, (int) ceil(max(a.x, max(b.x, c.x))));
+    int minY = max(0, (int) floor(min(a.y, min(b.y, c.y))));
+    int maxY = min(height - 1, (int) ceil(max(a.y, max(b.y, c.y))));
+    if (minX > maxX || minY > maxY) {
+        return;
+    }
+    numOccluderTriangles++;
+
+    // Edge functions and depth as planes in x/y, sampled at pixel centers
+    float edgeOneX = b.y - c.y, edgeOneY = c.x - b.x;
+    float edgeTwoX = c.y - a.y, edgeTwoY = a.x - c.x;
+    float edgeThreeX = a.y - b.y, edgeThreeY = b.x - a.x;
+    float depthX = (edgeOneX * a.z + edgeTwoX * b.z + edgeThreeX * c.z) / area;
+    float depthY = (edgeOneY * a.z + edgeTwoY * b.z + edgeThreeY * c.z) / area;
+
+    // Start at a multiple of 4 so rows can be done 4 pixels at a time
+    minX &= ~3;
+    for (int y = minY; y <= maxY; y++) {
+        float px = minX + 0.5f;
+        float py = y + 0.5f;
+        float edgeOne = edgeOneX * (px - b.x) + edgeOneY * (py - b.y);
+        float edgeTwo = edgeTwoX * (px - c.x) + edgeTwoY * (py - c.y);
+        float edgeThree = edgeThreeX * (px - a.x) + edgeThreeY * (py - a.y);
+        float rowDepth = a.z + depthX * (px - a.x) + depthY * (py - a.y);
+        float* row = &depth[y * width];
+
+#ifdef OCCLUSION_CULLER_SSE2
+        __m128 steps = _mm_setr_ps(0, 1, 2, 3);
+        __m128 zero = _mm_setzero_ps();
+        __m128 edgeOneStep = _mm_set1_ps(edgeOneX * 4), edgeTwoStep = _mm_set1_ps(edgeTwoX * 4), edgeThreeStep = _mm_set1_ps(edgeThreeX * 4), depthStep = _mm_set1_ps(depthX * 4);
+        __m128 edgeOneValues = _mm_add_ps(_mm_set1_ps(edgeOne), _mm_mul_ps(steps, _mm_set1_ps(edgeOneX)));
+        __m128 edgeTwoValues = _mm_add_ps(_mm_set1_ps(edgeTwo), _mm_mul_ps(steps, _mm_set1_ps(edgeTwoX)));
+        __m128 edgeThreeValues = _mm_add_ps(_mm_set1_ps(edgeThree), _mm_mul_ps(steps, _mm_set1_ps(edgeThreeX)));
+        __m128 depthValues = _mm_add_ps(_mm_set1_ps(rowDepth), _mm_mul_ps(steps, _mm_set1_ps(depthX)));
+        for (int x = minX; x <= maxX; x += 4) {
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edgeOneValues, zero), _mm_cmpge_ps(edgeTwoValues, zero)), _mm_cmpge_ps(edgeThreeValues, zero));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(depthValues, zero));
+            if (_mm_movemask_ps(inside) != 0) {
+                __m128 current = _mm_loadu_ps(row + x);
+                __m128 nearest = _mm_min_ps(current, depthValues);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+            }
+
+            edgeOneValues = _mm_add_ps(edgeOneValues, edgeOneStep);
+            edgeTwoValues = _mm_add_ps(edgeTwoValues, edgeTwoStep);
+            edgeThreeValues = _mm_add_ps(edgeThreeValues, edgeThreeStep);
+            depthValues = _mm_add_ps(depthValues, depthStep);
+        }
+#else
+        for (int x = minX; x <= maxX; x++) {
+            if (edgeOne >= 0 && edgeTwo >= 0 && edgeThree >= 0 && rowDepth >= 0) {
+                row[x] = min(row[x], rowDepth);
+            }
+
+            edgeOne += edgeOneX;
+            edgeTwo += edgeTwoX;
+            edgeThree += edgeThreeX;
+            rowDepth += depthX;
+        }
+#endif
+    }
+}
+
+// Farthest depth of each tile
+void OcclusionCuller::buildHierarchy() {
+    auto start = chrono::high_resolution_clock::now();
+
+    for (int tileY = 0; tileY < tilesY; tileY++) {
+        for (int tileX = 0; tileX < tilesX; tileX++) {
+            float farthest = 0;
+            for (int y = tileY * tileSize; y < (tileY + 1) * tileSize; y++) {
+                const float* row = &depth[y * width + tileX * tileSize];
+                for (int x = 0; x < tileSize; x++) {
+                    farthest = max(farthest, row[x]);
+                }
+            }
+            tileMaxDepth[tileY * tilesX + tileX] = farthest;
+        }
+    }
+
+    auto finish = chrono::high_resolution_clock::now();
+    rasterizeTime += chrono::duration_cast<chrono::microseconds>(finish - start).count();
+}
+
+// False if the box is off screen or behind the occluders everywhere it covers
+bool OcclusionCuller::isVisible(glm::vec3 boundsMin, glm::vec3 boundsMax, glm::mat4 matrix) {
+    auto start = chrono::high_resolution_clock::now();
+    numTested++;
+
+    // Screen rectangle and nearest depth of the 8 corners
+    float minX = width, maxX = -1, minY = height, maxY = -1, nearest = 1;
+    bool visible = false;
+    bool decided = false;
+    for (int i = 0; i < 8 && !decided; i++) {
+        glm::vec3 corner((i & 1) ? boundsMax.x : boundsMin.x, (i & 2) ? boundsMax.y : boundsMin.y, (i & 4) ? boundsMax.z : boundsMin.z);
+        glm::vec4 clip = matrix * glm::vec4(corner, 1);
+
+        // Crossing the near plane, assume visible
+        if (clip.w <= 1e-5f) {
+            visible = true;
+            decided = true;
+            break;
+        }
+
+        glm::vec3 screen = toScreen(clip);
+        minX = min(minX, screen.x);
+        maxX = max(maxX, screen.x);
+        minY = min(minY, screen.y);
+        maxY = max(maxY, screen.y);
+        nearest = min(nearest, screen.z);
+    }
+
+    if (!decided) {
+        int startX = max(0, (int) floor(minX));
+        int endX = min(width - 1, (int) floor(maxX));
+        int startY = max(0, (int) floor(minY));
+        int endY = min(height - 1, (int) floor(maxY));
+
+        // Outside the screen or beyond the far plane
+        if (startX > endX || startY > endY || nearest > 1) {
+            numOutside++;
+            decided = true;
+        }
+
+        // Tiles first, pixels only where a tile can't decide
+        for (int tileY = startY / tileSize; tileY <= endY / tileSize && !decided; tileY++) {
+            for (int tileX = startX / tileSize; tileX <= endX / tileSize && !decided; tileX++) {
+                if (nearest > tileMaxDepth[tileY * tilesX + tileX]) {
+                    continue;
+                }
+
+                int pixelStartX = max(startX, tileX * tileSize), pixelEndX = min(endX, (tileX + 1) * tileSize - 1);
+                int pixelStartY = max(startY, tileY * tileSize), pixelEndY = min(endY, (tileY + 1) * tileSize - 1);
+                for (int y = pixelStartY; y <= pixelEndY && !decided; y++) {
+                    for (int x = pixelStartX; x <= pixelEndX; x++) {
+                        if (nearest <= depth[y * width + x]) {
+                            visible = true;
+                            decided = true;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (!decided) {
+            numOccluded++;
+        }
+    }
+
+    auto finish = chrono::high_resolution_clock::now();
+    testTime += chrono::duration_cast<chrono::microseconds>(finish - start).count();
+    return visible;
+}
+
+// Depth Buffer Getters
+float OcclusionCuller::getDepth(int x, int y) {
+    return depth.at(y * width + x);
+}
+int OcclusionCuller::getWidth() {
+    return width;
+}
+int OcclusionCuller::getHeight() {
+    return height;
+}
+
+// Statistics
+void OcclusionCuller::resetStatistics() {
+    numOccluderTriangles = 0;
+    numTested = 0;
+    numOccluded = 0;
+    numOutside = 0;
+    rasterizeTime = 0;
+    testTime = 0;
+}
+int OcclusionCuller::getNumOccluderTriangles() {
+    return numOccluderTriangles;
+}
+int OcclusionCuller::getNumTested() {
+    return numTested;
+}
+int OcclusionCuller::getNumOccluded() {
+    return numOccluded;
+}
+int OcclusionCuller::getNumOutside() {
+    return numOutside;
+}
+long OcclusionCuller::getRasterizeTime() {
+    return rasterizeTime;
+}
+long OcclusionCuller::getTestTime() {
+    return testTime;
+}
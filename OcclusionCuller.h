@@ -0,0 +1,48 @@
+#pragma once
+#include "Model.h"
+
+// Software depth buffer of occluder triangles at a low resolution, with the
+// farthest depth of each tile kept so bounding boxes can be rejected quickly
+class OcclusionCuller {
+    static const int tileSize = 8;
+
+    // Depth Buffer ([0, 1], cleared to 1 = far)
+    int width, height;
+    int tilesX, tilesY;
+    vector<float> depth;
+    vector<float> tileMaxDepth;
+
+    // Statistics since resetStatistics
+    int numOccluderTriangles = 0;
+    int numTested = 0;
+    int numOccluded = 0;
+    int numOutside = 0;
+    long rasterizeTime = 0;
+    long testTime = 0;
+
+    void rasterizeTriangle(glm::vec4 pointOne, glm::vec4 pointTwo, glm::vec4 pointThree);
+    glm::vec3 toScreen(glm::vec4 clip);
+
+public:
+    // Width/Height are rounded up to whole tiles
+    OcclusionCuller(int width, int height);
+
+    // Per Frame: clear, add occluders, build the hierarchy, then test
+    void clear();
+    void addOccluders(const vector<glm::vec3>& triangles, glm::mat4 matrix);
+    void buildHierarchy();
+    bool isVisible(glm::vec3 boundsMin, glm::vec3 boundsMax, glm::mat4 matrix);
+
+    float getDepth(int x, int y);
+    int getWidth();
+    int getHeight();
+
+    // Statistics (times in microseconds)
+    void resetStatistics();
+    int getNumOccluderTriangles();
+    int getNumTested();
+    int getNumOccluded();
+    int getNumOutside();
+    long getRasterizeTime();
+    long getTestTime();
+};
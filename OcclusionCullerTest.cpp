@@ -0,0 +1,46 @@
+#include "OcclusionCuller.h"
+using namespace std;
+
+// Entry Point: rasterizes a known occluder quad and checks which boxes it hides, no window or OpenGL
+int main() {
+    // Settings
+        int width = 64;
+        int height = 48;
+
+    // Camera at the origin looking down -z, a 2x2 quad 5 units away covers a 4x4 square 10 units away
+    glm::mat4 matrix = glm::perspective(glm::radians(60.0f), (float) width / height, 0.5f, 100.0f) * glm::lookAt(glm::vec3(0, 0, 0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0));
+    vector<glm::vec3> quad = {
+        glm::vec3(-1, -1, -5), glm::vec3(1, -1, -5), glm::vec3(1, 1, -5),
+        glm::vec3(-1, -1, -5), glm::vec3(1, 1, -5), glm::vec3(-1, 1, -5)
+    };
+
+    OcclusionCuller culler(width, height);
+    culler.clear();
+    culler.addOccluders(quad, matrix);
+    culler.buildHierarchy();
+
+    int numFailed = 0;
+    auto check = [&](string name, bool value, bool expected) {
+        cout << "Occlusion Culler: " << name << ": " << (value == expected ? "passed" : "FAILED") << "." << endl;
+        if (value != expected) {
+            numFailed++;
+        }
+    };
+
+    check("quad depth at the center", culler.getDepth(width / 2, height / 2) < 1, true);
+    check("no depth at the corner", culler.getDepth(0, 0) == 1, true);
+    check("box behind the quad", culler.isVisible(glm::vec3(-0.5f, -0.5f, -11), glm::vec3(0.5f, 0.5f, -10), matrix), false);
+    check("box beside the quad", culler.isVisible(glm::vec3(3, -0.5f, -11), glm::vec3(4, 0.5f, -10), matrix), true);
+    check("box in front of the quad", culler.isVisible(glm::vec3(-0.5f, -0.5f, -4), glm::vec3(0.5f, 0.5f, -3), matrix), true);
+    check("box partly behind the quad", culler.isVisible(glm::vec3(1.5f, -0.5f, -11), glm::vec3(2.5f, 0.5f, -10), matrix), true);
+    check("box through the near plane", culler.isVisible(glm::vec3(-0.5f, -0.5f, -11), glm::vec3(0.5f, 0.5f, 1), matrix), true);
+
+    // Cleared again, nothing hides the box
+    culler.clear();
+    culler.buildHierarchy();
+    check("box behind a cleared buffer", culler.isVisible(glm::vec3(-0.5f, -0.5f, -11), glm::vec3(0.5f, 0.5f, -10), matrix), true);
+
+    check("statistics", culler.getNumOccluded() == 1 && culler.getNumTested() == 6, true);
+
+    return numFailed > 0 ? 1 : 0;
+}
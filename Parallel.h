@@ -0,0 +1,89 @@
+#pragma once
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+using namespace std;
+
+// Number of threads to use (0 for one per hardware thread)
+inline int getNumThreads(int requested) {
+    if (requested > 0) {
+        return requested;
+    }
+
+    return max(1, (int) thread::hardware_concurrency());
+}
+
+// Split [0, count) into one contiguous range per thread and run function(start, end) on each
+template <typename Function>
+void parallelFor(int count, int numThreads, Function function) {
+    numThreads = max(1, min(getNumThreads(numThreads), count));
+    if (numThreads == 1) {
+        function(0, count);
+        return;
+    }
+
+    vector<thread> threads;
+    for (int i = 0; i < numThreads; i++) {
+        int start = (int) ((long long) count * i / numThreads);
+        int end = (int) ((long long) count * (i + 1) / numThreads);
+        threads.push_back(thread(function, start, end));
+    }
+
+    for (int i = 0; i < threads.size(); i++) {
+        threads.at(i).join();
+    }
+}
+
+// Run function(index) for every index in [0, count) when items take very different times. Items are dealt
+// round robin and taken from the front, so each thread starts with its earliest item (sort longest first),
+// and a thread with an empty queue steals the earliest item left in another's.
+template <typename Function>
+void parallelForStealing(int count, int numThreads, Function function) {
+    numThreads = max(1, min(getNumThreads(numThreads), count));
+    if (numThreads == 1) {
+        for (int i = 0; i < count; i++) {
+            function(i);
+        }
+        return;
+    }
+
+    struct WorkQueue {
+        mutex lock;
+        deque<int> items;
+    };
+    vector<WorkQueue> queues(numThreads);
+    for (int i = 0; i < count; i++) {
+        queues[i % numThreads].items.push_back(i);
+    }
+
+    // Nothing is added once started, so finding every queue empty means the work is done
+    auto worker = [&](int self) {
+        while (true) {
+            int item = -1;
+            for (int i = 0; i < numThreads && item == -1; i++) {
+                WorkQueue& queue = queues[(self + i) % numThreads];
+                lock_guard<mutex> guard(queue.lock);
+                if (!queue.items.empty()) {
+                    item = queue.items.front();
+                    queue.items.pop_front();
+                }
+            }
+
+            if (item == -1) {
+                return;
+            }
+            function(item);
+        }
+    };
+
+    vector<thread> threads;
+    for (int i = 0; i < numThreads; i++) {
+        threads.push_back(thread(worker, i));
+    }
+
+    for (int i = 0; i < threads.size(); i++) {
+        threads.at(i).join();
+    }
+}
@@ -0,0 +1,227 @@
+#include "RegressionHarness.h"
+
+// Constructor
+RegressionHarness::RegressionHarness(string goldenPrefix, string actualPrefix, int channelTolerance, float maxDifferentPixels, float regressionThreshold, double minimumDifference, bool record) {
+    this->goldenPrefix = goldenPrefix;
+    this->actualPrefix = actualPrefix;
+    this->record = record;
+    this->channelTolerance = channelTolerance;
+    this->maxDifferentPixels = maxDifferentPixels;
+    this->regressionThreshold = regressionThreshold;
+    this->minimumDifference = minimumDifference;
+}
+
+// Binary PPM (P6) with 8 bit channels
+bool RegressionHarness::readImage(string fileName, int* width, int* height, vector<unsigned char>* pixels) {
+    ifstream file(fileName, ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    string magic;
+    int maxValue = 0;
+    file >> magic >> *width >> *height >> maxValue;
+    file.get();
+    if (magic != "P6" || maxValue != 255 || *width <= 0 || *height <= 0) {
+        cout << "File: \'" << fileName << "\' is not an 8 bit binary PPM." << endl;
+        return false;
+    }
+
+    pixels->resize(*width * *height * 3);
+    file.read((char*) pixels->data(), pixels->size());
+    return (bool) file;
+}
+
+bool RegressionHarness::writeImage(string fileName, int width, int height, const vector<unsigned char>& pixels) {
+    ofstream file(fileName, ios::binary);
+    if (!file.is_open()) {
+        cout << "File: \'" << fileName << "\' failed to open." << endl;
+        return false;
+    }
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+    file.write((const char*) pixels.data(), width * height * 3);
+    return (bool) file;
+}
+
+// Compare with <golden prefix><name>.ppm, writing <actual prefix><name>_actual.ppm on failure
+bool RegressionHarness::compareImage(string name, int width, int height, const vector<unsigned char>& pixels) {
+    numImages++;
+    string goldenFileName = goldenPrefix + name + ".ppm";
+
+    if (record) {
+        if (writeImage(goldenFileName, width, height, pixels)) {
+            numImagesRecorded++;
+            return true;
+        }
+        numImagesFailed++;
+        return false;
+    }
+
+    int goldenWidth, goldenHeight;
+    vector<unsigned char> golden;
+    if (!readImage(goldenFileName, &goldenWidth, &goldenHeight, &golden)) {
+        cout << "Regression: " << name << ": FAILED, no golden image \'" << goldenFileName << "\' (record with --record-goldens)." << endl;
+        writeImage(actualPrefix + name + "_actual.ppm", width, height, pixels);
+        numImagesFailed++;
+        return false;
+    }
+
+    if (goldenWidth != width || goldenHeight != height) {
+        cout << "Regression: " << name << ": FAILED, golden is " << goldenWidth << "x" << goldenHeight << ", rendered " << width << "x" << height << "." << endl;
+        writeImage(actualPrefix + name + "_actual.ppm", width, height, pixels);
+        numImagesFailed++;
+        return false;
+    }
+
+    int numDifferent = 0;
+    int maxDifference = 0;
+    for (int i = 0; i < width * height; i++) {
+        int difference = 0;
+        for (int j = 0; j < 3; j++) {
+            difference = max(difference, abs((int) pixels[i * 3 + j] - (int) golden[i * 3 + j]));
+        }
+        if (difference > channelTolerance) {
+            numDifferent++;
+        }
+        maxDifference = max(maxDifference, difference);
+    }
+
+    float differentFraction = (float) numDifferent / (width * height);
+    bool match = differentFraction <= maxDifferentPixels;
+    if (!match) {
+        cout << "Regression: " << name << ": FAILED, " << numDifferent << " pixels differ (max difference " << maxDifference << ")." << endl;
+        writeImage(actualPrefix + name + "_actual.ppm", width, height, pixels);
+        numImagesFailed++;
+    }
+
+    return match;
+}
+
+// Read every "name": number pair of a flat JSON object and the "renderer" and "buildType" strings, other values are skipped
+bool RegressionHarness::loadBaseline(string fileName) {
+    ifstream file(fileName);
+    if (!file.is_open()) {
+        cout << "File: \'" << fileName << "\' failed to open (record with --record-goldens)." << endl;
+        return false;
+    }
+
+    stringstream stream;
+    stream << file.rdbuf();
+    string text = stream.str();
+
+    size_t position = 0;
+    while ((position = text.find('"', position)) != string::npos) {
+        size_t end = text.find('"', position + 1);
+        if (end == string::npos) {
+            break;
+        }
+        string key = text.substr(position + 1, end - position - 1);
+        position = end + 1;
+
+        size_t colon = text.find_first_not_of(" \t\r\n", position);
+        if (colon == string::npos || text[colon] != ':') {
+            continue;
+        }
+
+        // The renderer and build type are the only string values, written without escapes
+        size_t valueQuote = text.find_first_not_of(" \t\r\n", colon + 1);
+        if ((key == "renderer" || key == "buildType") && valueQuote != string::npos && text[valueQuote] == '"') {
+            size_t valueQuoteEnd = text.find('"', valueQuote + 1);
+            if (valueQuoteEnd == string::npos) {
+                break;
+            }
+            string value = text.substr(valueQuote + 1, valueQuoteEnd - valueQuote - 1);
+            if (key == "renderer") {
+                baselineRenderer = value;
+            }
+            else {
+                baselineBuildType = value;
+            }
+            position = valueQuoteEnd + 1;
+            continue;
+        }
+
+        const char* valueStart = text.c_str() + colon + 1;
+        char* valueEnd;
+        double value = strtod(valueStart, &valueEnd);
+        if (valueEnd != valueStart) {
+            baseline[key] = value;
+            position = valueEnd - text.c_str();
+        }
+    }
+
+    baselineLoaded = true;
+    return true;
+}
+
+void RegressionHarness::setRenderer(string renderer) {
+    this->renderer = renderer;
+}
+
+void RegressionHarness::setBuildType(string buildType) {
+    this->buildType = buildType;
+}
+
+void RegressionHarness::addMetric(string name, double value, bool gated) {
+    metrics.push_back({name, value, gated});
+}
+
+// Fail gated metrics more than the threshold over their baseline, the minimum difference keeps short timings from
+// failing on noise, and timings from another renderer or build type are not comparable
+bool RegressionHarness::checkMetrics() {
+    numMetricsFailed = 0;
+    if (!baselineLoaded) {
+        return record;
+    }
+    if (baselineRenderer != renderer) {
+        cout << "Regression: baseline renderer \'" << baselineRenderer << "\' is not \'" << renderer << "\', timings not checked." << endl;
+        return true;
+    }
+    if (baselineBuildType != buildType) {
+        cout << "Regression: baseline build type \'" << baselineBuildType << "\' is not \'" << buildType << "\', timings not checked." << endl;
+        return true;
+    }
+
+    for (int i = 0; i < metrics.size(); i++) {
+        auto found = baseline.find(metrics.at(i).name);
+        if (!metrics.at(i).gated || found == baseline.end()) {
+            continue;
+        }
+
+        double limit = max(found->second * (1 + regressionThreshold), found->second + minimumDifference);
+        if (metrics.at(i).value > limit) {
+            cout << "Regression: " << metrics.at(i).name << ": FAILED, " << metrics.at(i).value << " over baseline " << found->second << "." << endl;
+            numMetricsFailed++;
+        }
+    }
+
+    return numMetricsFailed == 0;
+}
+
+bool RegressionHarness::writeMetrics(string fileName) {
+    ofstream file(fileName);
+    if (!file.is_open()) {
+        cout << "File: \'" << fileName << "\' failed to open." << endl;
+        return false;
+    }
+
+    file << "{" << endl;
+    file << "    \"renderer\": \"" << renderer << "\"," << endl;
+    file << "    \"buildType\": \"" << buildType << "\"";
+    for (int i = 0; i < metrics.size(); i++) {
+        file << "," << endl << "    \"" << metrics.at(i).name << "\": " << metrics.at(i).value;
+    }
+    file << endl << "}" << endl;
+    return (bool) file;
+}
+
+bool RegressionHarness::passed() {
+    return numImagesFailed == 0 && numMetricsFailed == 0 && (record || baselineLoaded);
+}
+
+void RegressionHarness::printSummary() {
+    cout << "Regression: " << numImages << " images, " << numImagesFailed << " failed, " << numImagesRecorded << " recorded." << endl;
+    cout << "Regression: " << metrics.size() << " metrics, " << numMetricsFailed << " regressed" << (record ? " (recorded as baseline)" : !baselineLoaded ? " (no baseline)" : "") << "." << endl;
+    cout << "Regression: " << (passed() ? "PASSED" : "FAILED") << endl;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace std;
+
+// Compares rendered images with golden PPM files and timing metrics with a baseline JSON
+// file. Missing goldens/baselines fail, unless recording, which overwrites them instead.
+class RegressionHarness {
+    // Image Comparison (a pixel differs when any channel is off by more than the tolerance), images
+    // that do not match are written with the actual prefix so the goldens' directory stays untouched
+    string goldenPrefix;
+    string actualPrefix;
+    int channelTolerance;
+    float maxDifferentPixels;
+    bool record;
+
+    // Metrics (lower is better, a regression is more than the threshold and the minimum difference
+    // over the baseline), timings are only compared with a baseline taken on the same renderer and
+    // build type, and ungated metrics are recorded without being compared
+    struct Metric {
+        string name;
+        double value;
+        bool gated;
+    };
+    float regressionThreshold;
+    double minimumDifference;
+    vector<Metric> metrics;
+    map<string, double> baseline;
+    string renderer;
+    string baselineRenderer;
+    string buildType;
+    string baselineBuildType;
+    bool baselineLoaded = false;
+
+    // Results
+    int numImages = 0;
+    int numImagesFailed = 0;
+    int numImagesRecorded = 0;
+    int numMetricsFailed = 0;
+
+    static bool readImage(string fileName, int* width, int* height, vector<unsigned char>* pixels);
+    static bool writeImage(string fileName, int width, int height, const vector<unsigned char>& pixels);
+
+public:
+    RegressionHarness(string goldenPrefix, string actualPrefix, int channelTolerance, float maxDifferentPixels, float regressionThreshold, double minimumDifference, bool record);
+
+    // Pixels are RGB, top row first
+    bool compareImage(string name, int width, int height, const vector<unsigned char>& pixels);
+
+    // Metrics
+    bool loadBaseline(string fileName);
+    void setRenderer(string renderer);
+    void setBuildType(string buildType);
+    void addMetric(string name, double value, bool gated = true);
+    bool checkMetrics();
+    bool writeMetrics(string fileName);
+
+    bool passed();
+    void printSummary();
+};
@@ -0,0 +1,161 @@
+#include "Scene.h"
+
+// Constructor
+Scene::Scene() {
+}
+
+// Destructor
+Scene::~Scene() {
+    // Delete all models
+    for (int i = 0; i < models.size(); i++) {
+        delete models.at(i);
+    }
+}
+
+// Load an object file, returns the model index
+int Scene::addModel(string fileName) {
+    models.push_back(new Model(fileName));
+    return models.size() - 1;
+}
+
+// Add an already made model (the scene deletes it)
+int Scene::addModel(Model* model) {
+    models.push_back(model);
+    return models.size() - 1;
+}
+
+// Add a node below parent (-1 for a root), model is -1 for none
+int Scene::addNode(int parent, int model) {
+    if (parent >= (int) parents.size()) {
+        cout << "Parent node " << parent << " does not exist, adding as a root." << endl;
+        parent = -1;
+    }
+
+    parents.push_back(parent);
+    nodeModels.push_back(model);
+    translates.push_back(glm::vec3(0, 0, 0));
+    angles.push_back(glm::vec3(0, 0, 0));
+    scales.push_back(glm::vec3(1, 1, 1));
+    localMatrices.push_back(glm::mat4(1));
+    worldMatrices.push_back(glm::mat4(1));
+    localDirty.push_back(true);
+    worldChanged.push_back(true);
+    anyDirty = true;
+
+    return parents.size() - 1;
+}
+
+// Reserve space for many nodes
+void Scene::reserveNodes(int numNodes) {
+    parents.reserve(numNodes);
+    nodeModels.reserve(numNodes);
+    translates.reserve(numNodes);
+    angles.reserve(numNodes);
+    scales.reserve(numNodes);
+    localMatrices.reserve(numNodes);
+    worldMatrices.reserve(numNodes);
+    localDirty.reserve(numNodes);
+    worldChanged.reserve(numNodes);
+}
+
+// Node Transform Getters
+glm::vec3 Scene::getTranslate(int node) {
+    return translates.at(node);
+}
+glm::vec3 Scene::getAngles(int node) {
+    return angles.at(node);
+}
+glm::vec3 Scene::getScale(int node) {
+    return scales.at(node);
+}
+
+// Node Transform Setters
+void Scene::setTranslate(int node, glm::vec3 translate) {
+    translates.at(node) = translate;
+    markDirty(node);
+}
+void Scene::setAngles(int node, glm::vec3 angles) {
+    this->angles.at(node) = angles;
+    markDirty(node);
+}
+void Scene::setScale(int node, glm::vec3 scale) {
+    scales.at(node) = scale;
+    markDirty(node);
+}
+
+// Local matrix must be remade, children are handled during update
+void Scene::markDirty(int node) {
+    localDirty.at(node) = true;
+    anyDirty = true;
+}
+
+// Update all matrices that changed since the last update
+void Scene::update() {
+    // View projection once per frame
+    view = glm::lookAt(cameraPosition, cameraTarget, upVec);
+    glm::mat4 projection = glm::perspective(glm::radians(fov), aspectRatio, nearClippingPlane, farClippingPlane);
+    glm::mat4 newViewProjection = projection * view;
+    viewProjectionChanged = newViewProjection != viewProjection;
+    viewProjection = newViewProjection;
+
+    // Nothing moved, only clear last frame's changes
+    if (!anyDirty) {
+        fill(worldChanged.begin(), worldChanged.end(), false);
+        return;
+    }
+
+    // Parents come first, so a parent's world matrix is final before its children
+    int numNodes = parents.size();
+    for (int i = 0; i < numNodes; i++) {
+        if (localDirty[i]) {
+            localMatrices[i] = Model::generateModelMatrix(translates[i], angles[i], scales[i]);
+        }
+
+        int parent = parents[i];
+        bool changed = localDirty[i] || (parent >= 0 && worldChanged[parent]);
+        if (changed) {
+            worldMatrices[i] = parent >= 0 ? worldMatrices[parent] * localMatrices[i] : localMatrices[i];
+        }
+
+        worldChanged[i] = changed;
+        localDirty[i] = false;
+    }
+
+    anyDirty = false;
+}
+
+// Matrix Getters
+glm::mat4 Scene::getViewMatrix() {
+    return view;
+}
+glm::mat4 Scene::getViewProjectionMatrix() {
+    return viewProjection;
+}
+glm::mat4 Scene::getWorldMatrix(int node) {
+    return worldMatrices.at(node);
+}
+glm::mat4 Scene::getMatrix(int node) {
+    return viewProjection * worldMatrices.at(node);
+}
+
+// If the node's full matrix changed in the last update
+bool Scene::hasChanged(int node) {
+    return viewProjectionChanged || worldChanged.at(node);
+}
+
+// Scene Getters
+int Scene::getNumNodes() {
+    return parents.size();
+}
+int Scene::getNumModels() {
+    return models.size();
+}
+int Scene::getNodeModel(int node) {
+    return nodeModels.at(node);
+}
+int Scene::getParent(int node) {
+    return parents.at(node);
+}
+Model* Scene::getModel(int model) {
+    return models.at(model);
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "Model.h"
+#include <algorithm>
+
+class Scene {
+    // Node Hierarchy (a parent always comes before its children)
+    vector<int> parents;
+    vector<int> nodeModels;
+
+    // Node Transforms (contiguous so updates are one linear pass)
+    vector<glm::vec3> translates;
+    vector<glm::vec3> angles;
+    vector<glm::vec3> scales;
+    vector<glm::mat4> localMatrices;
+    vector<glm::mat4> worldMatrices;
+
+    // Dirty Flags
+    vector<char> localDirty;
+    vector<char> worldChanged;
+    bool anyDirty = false;
+    bool viewProjectionChanged = true;
+
+    // Loaded Models (shared between nodes)
+    vector<Model*> models;
+
+    // Calculated once per frame
+    glm::mat4 view = glm::mat4(1);
+    glm::mat4 viewProjection = glm::mat4(1);
+
+    void markDirty(int node);
+
+public:
+    // View Matrix
+    glm::vec3 cameraPosition = glm::vec3(0, 0, 0);
+    glm::vec3 cameraTarget = glm::vec3(0, 0, 0);
+    glm::vec3 upVec = glm::vec3(0, 1, 0);
+
+    // Projection Matrix
+    float fov = 45;
+    float nearClippingPlane = 0.1f;
+    float farClippingPlane = 100.0f;
+    float aspectRatio = 1.0;
+
+    // Constructor/Destructor
+    Scene();
+    ~Scene();
+
+    // Building the Scene
+    int addModel(string fileName);
+    int addModel(Model* model);
+    int addNode(int parent, int model);
+    void reserveNodes(int numNodes);
+
+    // Node Transforms
+    glm::vec3 getTranslate(int node);
+    glm::vec3 getAngles(int node);
+    glm::vec3 getScale(int node);
+    void setTranslate(int node, glm::vec3 translate);
+    void setAngles(int node, glm::vec3 angles);
+    void setScale(int node, glm::vec3 scale);
+
+    // Recalculate dirty world matrices and the view projection matrix
+    void update();
+
+    glm::mat4 getViewMatrix();
+    glm::mat4 getViewProjectionMatrix();
+    glm::mat4 getWorldMatrix(int node);
+    glm::mat4 getMatrix(int node);
+    bool hasChanged(int node);
+
+    int getNumNodes();
+    int getNumModels();
+    int getNodeModel(int node);
+    int getParent(int node);
+    Model* getModel(int model);
+};
@@ -0,0 +1,316 @@
+#include "ShaderManager.h"
+
+// Cache File Header
+static const char shaderCacheMagic[4] = {'M', 'T', 'S', 'C'};
+static const int shaderCacheVersion = 1;
+
+// Constructor
+ShaderManager::ShaderManager(bool useCache, string cachePrefix) {
+    this->useCache = useCache && binariesSupported();
+    this->cachePrefix = cachePrefix;
+
+    if (useCache && !this->useCache) {
+        cout << "Program binaries are not supported by the driver, compiling shaders from source." << endl;
+    }
+}
+
+// Needs GL 4.1 or ARB_get_program_binary, and at least one binary format
+bool ShaderManager::binariesSupported() {
+    if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary) {
+        return false;
+    }
+
+    int numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    return numFormats > 0;
+}
+
+// Read a whole shader file
+string ShaderManager::readFile(string fileName) {
+    ifstream file(fileName);
+    if (!file.is_open()) {
+        cout << "File: \'" << fileName << "\' failed to open." << endl;
+        return "";
+    }
+
+    stringstream stream;
+    stream << file.rdbuf();
+    return stream.str();
+}
+
+// Replace #include "file" lines with the file (relative to the including shader), GLSL has no includes
+string ShaderManager::addIncludes(string source, string fileName) {
+    size_t slash = fileName.find_last_of("/\\");
+    string directory = slash == string::npos ? "" : fileName.substr(0, slash + 1);
+
+    string result;
+    stringstream stream(source);
+    string line;
+    while (getline(stream, line)) {
+        size_t open = line.find('"');
+        size_t close = line.rfind('"');
+        if (line.compare(0, 8, "#include") == 0 && open != string::npos && close > open) {
+            result += readFile(directory + line.substr(open + 1, close - open - 1)) + "\n";
+        }
+        else {
+            result += line + "\n";
+        }
+    }
+
+    return result;
+}
+
+// Insert #define lines after the #version line
+string ShaderManager::addDefines(string source, vector<string> defines) {
+    if (defines.empty()) {
+        return source;
+    }
+
+    string defineLines;
+    for (int i = 0; i < defines.size(); i++) {
+        defineLines += "#define " + defines.at(i) + "\n";
+    }
+
+    size_t insertAt = 0;
+    if (source.compare(0, 8, "#version") == 0) {
+        size_t lineEnd = source.find('\n');
+        insertAt = lineEnd == string::npos ? source.size() : lineEnd + 1;
+    }
+
+    return source.insert(insertAt, defineLines);
+}
+
+// 64 bit FNV-1a
+unsigned long long ShaderManager::hashString(string text, unsigned long long hash) {
+    for (int i = 0; i < text.size(); i++) {
+        hash ^= (unsigned char) text[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+// Binaries are only valid for the driver that made them
+string ShaderManager::getDriverString() {
+    const char* vendor = (const char*) glGetString(GL_VENDOR);
+    const char* renderer = (const char*) glGetString(GL_RENDERER);
+    const char* version = (const char*) glGetString(GL_VERSION);
+    return string(vendor ? vendor : "") + "|" + (renderer ? renderer : "") + "|" + (version ? version : "");
+}
+
+// Compile one shader stage, outputting the full info log on failure
+unsigned int ShaderManager::compileShader(GLenum type, string source, string fileName) {
+    unsigned int shader = glCreateShader(type);
+    const char* sourcePointer = source.c_str();
+    glShaderSource(shader, 1, &sourcePointer, NULL);
+    glCompileShader(shader);
+
+    int success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        int logLength = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+        string infoLog(max(logLength, 1), '\0');
+        glGetShaderInfoLog(shader, infoLog.size(), NULL, &infoLog[0]);
+        cout << "ERROR::SHADER::" << (type == GL_VERTEX_SHADER ? "VERTEX" : "FRAGMENT") << "::COMPILATION_FAILED (" << fileName << ")\n" << infoLog << endl;
+    }
+
+    return shader;
+}
+
+// Link shaders (no fragment shader when its source is empty)
+unsigned int ShaderManager::linkProgram(string vertexSource, string fragmentSource, vector<string> feedbackVaryings) {
+    unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource, "vertex");
+    unsigned int fragmentShader = fragmentSource.empty() ? 0 : compileShader(GL_FRAGMENT_SHADER, fragmentSource, "fragment");
+
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    if (fragmentShader != 0) {
+        glAttachShader(program, fragmentShader);
+    }
+
+    // Varyings must be set before linking
+    if (!feedbackVaryings.empty()) {
+        vector<const char*> varyingNames;
+        for (int i = 0; i < feedbackVaryings.size(); i++) {
+            varyingNames.push_back(feedbackVaryings.at(i).c_str());
+        }
+        glTransformFeedbackVaryings(program, varyingNames.size(), varyingNames.data(), GL_INTERLEAVED_ATTRIBS);
+    }
+
+    if (useCache) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(program);
+
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        int logLength = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+        string infoLog(max(logLength, 1), '\0');
+        glGetProgramInfoLog(program, infoLog.size(), NULL, &infoLog[0]);
+        cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << endl;
+        glDeleteProgram(program);
+        program = 0;
+    }
+
+    glDeleteShader(vertexShader);
+    if (fragmentShader != 0) {
+        glDeleteShader(fragmentShader);
+    }
+
+    return program;
+}
+
+// Load a cached binary if it matches the hash and driver (0 if not)
+unsigned int ShaderManager::loadBinary(string cacheFileName, unsigned long long hash) {
+    ifstream file(cacheFileName, ios::binary);
+    if (!file.is_open()) {
+        return 0;
+    }
+
+    char magic[4];
+    int version = 0;
+    unsigned long long fileHash = 0;
+    int driverLength = 0;
+    file.read(magic, sizeof(magic));
+    file.read((char*) &version, sizeof(version));
+    file.read((char*) &fileHash, sizeof(fileHash));
+    file.read((char*) &driverLength, sizeof(driverLength));
+    if (!file || !equal(magic, magic + 4, shaderCacheMagic) || version != shaderCacheVersion || fileHash != hash || driverLength < 0 || driverLength > 4096) {
+        return 0;
+    }
+
+    string driver(driverLength, '\0');
+    file.read(&driver[0], driverLength);
+    if (!file || driver != getDriverString()) {
+        return 0;
+    }
+
+    GLenum binaryFormat = 0;
+    int binaryLength = 0;
+    file.read((char*) &binaryFormat, sizeof(binaryFormat));
+    file.read((char*) &binaryLength, sizeof(binaryLength));
+    if (!file || binaryLength <= 0) {
+        return 0;
+    }
+
+    vector<char> binary(binaryLength);
+    file.read(binary.data(), binaryLength);
+    if (!file) {
+        return 0;
+    }
+
+    // The driver can still reject it, then the caller compiles from source
+    unsigned int program = glCreateProgram();
+    glProgramBinary(program, binaryFormat, binary.data(), binaryLength);
+
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+// Save a linked program's binary
+void ShaderManager::saveBinary(unsigned int program, string cacheFileName, unsigned long long hash) {
+    int binaryLength = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+    if (binaryLength <= 0) {
+        return;
+    }
+
+    vector<char> binary(binaryLength);
+    GLenum binaryFormat = 0;
+    glGetProgramBinary(program, binaryLength, &binaryLength, &binaryFormat, binary.data());
+
+    ofstream file(cacheFileName, ios::binary);
+    if (!file.is_open()) {
+        cout << "File: \'" << cacheFileName << "\' failed to open." << endl;
+        return;
+    }
+
+    string driver = getDriverString();
+    int driverLength = driver.size();
+    file.write(shaderCacheMagic, sizeof(shaderCacheMagic));
+    file.write((char*) &shaderCacheVersion, sizeof(shaderCacheVersion));
+    file.write((char*) &hash, sizeof(hash));
+    file.write((char*) &driverLength, sizeof(driverLength));
+    file.write(driver.data(), driverLength);
+    file.write((char*) &binaryFormat, sizeof(binaryFormat));
+    file.write((char*) &binaryLength, sizeof(binaryLength));
+    file.write(binary.data(), binaryLength);
+    file.close();
+}
+
+// Load a program
+unsigned int ShaderManager::loadProgram(string vertexFileName, string fragmentFileName, vector<string> defines) {
+    string vertexSource = addDefines(addIncludes(readFile(vertexFileName), vertexFileName), defines);
+    string fragmentSource = addDefines(addIncludes(readFile(fragmentFileName), fragmentFileName), defines);
+    lastCacheHit = false;
+
+    // Everything that changes the linked program goes into the hash
+    unsigned long long hash = 14695981039346656037ULL;
+    hash = hashString(vertexSource, hash);
+    hash = hashString("\n--fragment--\n", hash);
+    hash = hashString(fragmentSource, hash);
+
+    stringstream cacheFileName;
+    cacheFileName << cachePrefix << hex << hash << ".bin";
+
+    if (useCache) {
+        unsigned int program = loadBinary(cacheFileName.str(), hash);
+        if (program != 0) {
+            lastCacheHit = true;
+            return program;
+        }
+    }
+
+    unsigned int program = linkProgram(vertexSource, fragmentSource, {});
+    if (useCache && program != 0) {
+        saveBinary(program, cacheFileName.str(), hash);
+    }
+
+    return program;
+}
+
+// Load a transform feedback program
+unsigned int ShaderManager::loadFeedbackProgram(string vertexFileName, vector<string> feedbackVaryings, vector<string> defines) {
+    string vertexSource = addDefines(addIncludes(readFile(vertexFileName), vertexFileName), defines);
+    lastCacheHit = false;
+
+    // The varyings change the linked program, so they are hashed too
+    unsigned long long hash = 14695981039346656037ULL;
+    hash = hashString(vertexSource, hash);
+    hash = hashString("\n--feedback--\n", hash);
+    for (int i = 0; i < feedbackVaryings.size(); i++) {
+        hash = hashString(feedbackVaryings.at(i) + "\n", hash);
+    }
+
+    stringstream cacheFileName;
+    cacheFileName << cachePrefix << hex << hash << ".bin";
+
+    if (useCache) {
+        unsigned int program = loadBinary(cacheFileName.str(), hash);
+        if (program != 0) {
+            lastCacheHit = true;
+            return program;
+        }
+    }
+
+    unsigned int program = linkProgram(vertexSource, "", feedbackVaryings);
+    if (useCache && program != 0) {
+        saveBinary(program, cacheFileName.str(), hash);
+    }
+
+    return program;
+}
+
+// If the last program came from the cache
+bool ShaderManager::wasCacheHit() {
+    return lastCacheHit;
+}
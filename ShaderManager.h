@@ -0,0 +1,42 @@
+#pragma once
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+using namespace std;
+
+// Compiles and links shader programs, keeping linked binaries in an on-disk
+// cache keyed by a hash of the sources (with their includes) and defines
+class ShaderManager {
+    bool useCache;
+    string cachePrefix;
+
+    // Last loaded program
+    bool lastCacheHit = false;
+
+    static string readFile(string fileName);
+    static string addIncludes(string source, string fileName);
+    static string addDefines(string source, vector<string> defines);
+    static unsigned long long hashString(string text, unsigned long long hash);
+    static string getDriverString();
+
+    unsigned int compileShader(GLenum type, string source, string fileName);
+    unsigned int linkProgram(string vertexSource, string fragmentSource, vector<string> feedbackVaryings);
+    unsigned int loadBinary(string cacheFileName, unsigned long long hash);
+    void saveBinary(unsigned int program, string cacheFileName, unsigned long long hash);
+
+public:
+    ShaderManager(bool useCache, string cachePrefix);
+
+    static bool binariesSupported();
+
+    // Load a program from the cache, or compile it from source (0 on failure)
+    unsigned int loadProgram(string vertexFileName, string fragmentFileName, vector<string> defines);
+
+    // Vertex only program capturing the varyings (interleaved, in order) with transform feedback
+    unsigned int loadFeedbackProgram(string vertexFileName, vector<string> feedbackVaryings, vector<string> defines);
+
+    bool wasCacheHit();
+};
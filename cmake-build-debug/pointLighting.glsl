@@ -0,0 +1,35 @@
+// Shared by source.vs (Gouraud) and source.fs (Phong), included by ShaderManager when they load
+// Uses the nearClippingPlane, farClippingPlane, phongExponent, specularColor, pointLightData,
+// clusterGrid, clusterLightIndices and clusterCounts uniforms of the including shader
+
+// Point lights of the cluster at this view position and screen tile
+vec3 pointLighting(vec3 position, vec3 viewNormal, vec3 color, ivec2 tile)
+{
+   float depth = max(-position.z, nearClippingPlane);
+   int slice = int(floor(log(depth / nearClippingPlane) / log(farClippingPlane / nearClippingPlane) * float(clusterCounts.z)));
+   slice = clamp(slice, 0, clusterCounts.z - 1);
+   uvec2 cluster = texelFetch(clusterGrid, (slice * clusterCounts.y + tile.y) * clusterCounts.x + tile.x).xy;
+
+   vec3 eyeVec = normalize(-position);
+   vec3 result = vec3(0, 0, 0);
+   for (uint i = 0u; i < cluster.y; i++) {
+       int light = int(texelFetch(clusterLightIndices, int(cluster.x + i)).x);
+       vec4 positionRadius = texelFetch(pointLightData, light * 2);
+       vec4 colorIntensity = texelFetch(pointLightData, light * 2 + 1);
+
+       vec3 toLight = positionRadius.xyz - position;
+       float lightDistance = length(toLight);
+       if (lightDistance >= positionRadius.w) {
+           continue;
+       }
+
+       vec3 lightDir = toLight / lightDistance;
+       float attenuation = 1 - lightDistance / positionRadius.w;
+       float intensity = colorIntensity.w * attenuation * attenuation;
+       vec3 h = normalize(eyeVec + lightDir);
+       result += intensity * max(0, dot(viewNormal, lightDir)) * colorIntensity.rgb * color;
+       result += intensity * max(0, pow(max(0, dot(viewNormal, h)), phongExponent)) * specularColor;
+   }
+
+   return result;
+}
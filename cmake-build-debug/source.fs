@@ -1,6 +1,8 @@
 #version 330 core
 in vec4 vFragColor;
 in vec3 vFragNormal;
+in vec3 vViewPosition;
+in vec3 vViewNormal;
 out vec4 FragColor;
 uniform int zBufferRenderMode;
 uniform int shadingMode;
@@ -9,6 +11,17 @@ uniform float lightIntensity;
 uniform float phongExponent;
 uniform vec3 lightVec;
 uniform vec3 specularColor;
+uniform float nearClippingPlane;
+uniform float farClippingPlane;
+uniform int pointLightsEnabled;
+uniform samplerBuffer pointLightData;
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterLightIndices;
+uniform ivec3 clusterCounts;
+uniform vec2 viewportSize;
+
+#include "pointLighting.glsl"
+
 void main()
 {
    // ZMode or ZTildeMode or ZPrimeMode or None or Flat or Gouraud
@@ -25,6 +38,12 @@ void main()
        vec3 specularLight = lightIntensity * max(0, pow(dot(vFragNormal, h), phongExponent)) * specularColor;
        vec4 newColor = vec4(ambientLight + diffuseLight + specularLight, vFragColor[3]);
 
+       // Clustered point lights, tile from the pixel
+       if (pointLightsEnabled == 1) {
+           ivec2 tile = clamp(ivec2(floor(gl_FragCoord.xy / viewportSize * vec2(clusterCounts.xy))), ivec2(0, 0), clusterCounts.xy - 1);
+           newColor.rgb += pointLighting(vViewPosition, normalize(vViewNormal), vec3(vFragColor), tile);
+       }
+
        newColor[0] = min(1, newColor[0]);
        newColor[1] = min(1, newColor[1]);
        newColor[2] = min(1, newColor[2]);
@@ -12,12 +12,26 @@ uniform float lightIntensity;
 uniform float phongExponent;
 uniform vec3 lightVec;
 uniform vec3 specularColor;
+uniform mat4 modelViewMatrix;
+uniform mat3 normalMatrix;
+uniform int pointLightsEnabled;
+uniform samplerBuffer pointLightData;
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterLightIndices;
+uniform ivec3 clusterCounts;
 out vec4 vFragColor;
 out vec3 vFragNormal;
+out vec3 vViewPosition;
+out vec3 vViewNormal;
+
+#include "pointLighting.glsl"
+
 void main()
 {
    gl_Position = matrix * vec4(aPos.x, aPos.y, aPos.z, aPos.w);
    vFragNormal = normalize(vec3(matrix * vec4(normal, 0)));
+   vViewPosition = vec3(modelViewMatrix * aPos);
+   vViewNormal = normalize(normalMatrix * normal);
 
    // None
    if (zBufferRenderMode == 0) {
@@ -35,6 +49,13 @@ void main()
            vec3 specularLight = lightIntensity * max(0, pow(dot(vFragNormal, h), phongExponent)) * specularColor;
            vec4 newColor = vec4(ambientLight + diffuseLight + specularLight, vFragColor[3]);
 
+           // Clustered point lights, tile from the projected vertex
+           if (pointLightsEnabled == 1 && gl_Position.w > 0) {
+               vec2 screen = (gl_Position.xy / gl_Position.w) * 0.5 + 0.5;
+               ivec2 tile = clamp(ivec2(floor(screen * vec2(clusterCounts.xy))), ivec2(0, 0), clusterCounts.xy - 1);
+               newColor.rgb += pointLighting(vViewPosition, vViewNormal, vec3(fragColor), tile);
+           }
+
            newColor[0] = min(1, newColor[0]);
            newColor[1] = min(1, newColor[1]);
            newColor[2] = min(1, newColor[2]);
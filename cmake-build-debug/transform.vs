@@ -0,0 +1,23 @@
+#version 330 core
+layout (location = 0) in vec4 aPos;
+layout (location = 1) in vec4 fragColor;
+layout (location = 2) in vec3 normal;
+uniform mat4 matrix;
+out vec4 tfPosition;
+out vec4 tfColor;
+out vec3 tfNormal;
+
+// Same transform as the CPU matrix mode, captured in the 11 float vertex layout
+void main()
+{
+   tfPosition = matrix * aPos;
+   tfColor = fragColor;
+
+   // Models drawn without normals keep zero normals
+   if (dot(normal, normal) > 0) {
+       tfNormal = normalize(vec3(matrix * vec4(normal, 0)));
+   }
+   else {
+       tfNormal = vec3(0, 0, 0);
+   }
+}
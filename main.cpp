@@ -1,19 +1,62 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include "Model.h"
+#include "Scene.h"
+#include "FrameScheduler.h"
+#include "CompressedMesh.h"
+#include "ShaderManager.h"
+#include "OcclusionCuller.h"
+#include "LightClusters.h"
+#include "RegressionHarness.h"
+#include "HalfEdgeMesh.h"
+#include "FrameCapture.h"
+#include "InputTrace.h"
 #include <string>
 #include <chrono>
+#include <random>
 
-// Function Headers
-void framebuffer_size_callback(GLFWwindow* window, int width, int height);
-bool processInput(GLFWwindow* window, Model* model, float translationStep, float angleStep, float fovStep);
+// Build type the baseline's timings depend on, set by CMake (empty when CMAKE_BUILD_TYPE is not set)
+#ifndef MODEL_TRANSFORMER_BUILD_TYPE
+#define MODEL_TRANSFORMER_BUILD_TYPE "unknown"
+#endif
 
 // Enums
 enum class zBuffer {None = 0, ZMode = 1, ZTildeMode = 2, ZPrimeMode = 3};
 enum class shading {None = 0, Flat = 1, Gouraud = 2, Phong = 3};
+// Where vertices are transformed: a GPU uniform each draw, the CPU on each move, or transform feedback on each move
+enum class transformation {GPU = 0, CPU = 1, Feedback = 2};
+
+// GPU Buffers of a Scene Node with a Model
+struct NodeBuffers {
+    int node;
+    unsigned int VAO, VBO, EBO;
+    float* vertices = nullptr;
+    unsigned int* indices = nullptr;
 
-// Entry Point
-int main() {
+    // Transformed vertices captured by transform feedback (drawn with the same EBO)
+    unsigned int feedbackVAO = 0, feedbackVBO = 0;
+};
+
+// Function Headers
+void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+bool processInput(unsigned int keys, Scene* scene, int node, float translationStep, float angleStep, float fovStep);
+void uploadNodeBuffers(NodeBuffers* buffers, Model* model, glm::mat4 matrix, bool useEBO, bool colorModifier, shading shadingMode);
+void setVertexAttributes();
+void createFeedbackBuffers(NodeBuffers* buffers, Model* model, bool useEBO);
+void runTransformFeedback(NodeBuffers* buffers, Model* model, bool useEBO, unsigned int transformProgram, unsigned int uniformTransformMatrixID, glm::mat4 matrix);
+float compareTransformFeedback(NodeBuffers* buffers, Model* model, bool useEBO, glm::mat4 matrix);
+void runTransformBenchmark(int gridSize, int numPoses, glm::mat4 baseMatrix, bool useEBO, bool colorModifier, shading shadingMode, unsigned int shaderProgram, unsigned int uniformMatrixID, unsigned int transformProgram, unsigned int uniformTransformMatrixID);
+void runSceneBenchmark(int numNodes, int numFrames, float dirtyFraction);
+void runNormalBenchmark(int gridSize, int maxThreads);
+void runHalfEdgeBenchmark(int gridSize, int maxThreads);
+void runCompressionBenchmark(Model* model, string name, size_t sourceSize, int numDecodes);
+vector<LightClusters::PointLight> generatePointLights(int numLights, glm::vec3 center, float spread, float radius, float intensity);
+GLFWwindow* createHiddenWindow(int width, int height);
+bool runRegressionHarness(RegressionHarness* harness, Scene* scene, int rootNode, vector<NodeBuffers>* nodeBuffers, vector<string> modelNames, vector<glm::vec3> poseAngles, int width, int height, int numFrames, bool colorModifier, glm::vec4 backgroundColor, unsigned int uniformMatrixID, unsigned int uniformZBufferRenderModeID, unsigned int uniformShadingModeID);
+
+// Entry Point (--regression runs the regression harness, --record-goldens records its goldens and baseline,
+// --golden-dir <dir> reads and records them in dir and --output-dir <dir> writes the metrics and failed images to dir)
+int main(int argc, char* argv[]) {
     // Settings
         // Screen Settings
         int SCR_WIDTH = 800;
@@ -21,11 +64,12 @@ int main() {
 
         // Type of Rendering
         bool useEBO = true;
-        bool cpuMatrix = false;
+        transformation transformMode = transformation::GPU;
         bool colorModifier = false;
         bool polygonMode = false;
         bool outputPerformanceTime = false;
         bool outputPosition = false;
+        bool useFileNormals = true;
         zBuffer zBufferRenderMode = zBuffer::None;
         shading shadingMode = shading::Flat;
         float ambientLightIntensity = 0.2f;
@@ -35,10 +79,24 @@ int main() {
         glm::vec3 lightVec = glm::normalize(glm::vec3(-1.0f, -1.0f, 1.0f));
         glm::vec3 specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
 
+        // Point Lights (placed randomly around the center, assigned to view frustum clusters)
+        int numPointLights = 0;
+        glm::vec3 pointLightCenter = glm::vec3(0, 0, 10);
+        float pointLightSpread = 3.0f;
+        float pointLightRadius = 1.5f;
+        float pointLightIntensity = 0.8f;
+        glm::ivec3 clusterCounts = glm::ivec3(16, 9, 24);
+
+        // Light Benchmark (renders continuously, averaging each light count over the frames)
+        bool lightBenchmark = false;
+        vector<int> lightBenchmarkCounts = {0, 64, 256, 1024, 4096};
+        int lightBenchmarkFrames = 100;
+
         // Matrix Settings
-        float translationScaleStep = 0.02;
-        float rotatationStep = 0.02;
-        float fovStep = 0.1;
+        // Speeds are per second, input is integrated in fixed time steps
+        float translationScaleSpeed = 1.2;
+        float rotationSpeed = 1.2;
+        float fovSpeed = 6.0;
         glm::vec3 translate = glm::vec3(0, 0, 10);
         float angleX = -45;
         float angleY = 0;
@@ -54,12 +112,111 @@ int main() {
         glm::vec3 cameraPosition = glm::vec3(0, 0, -1);
         glm::vec3 upVec = glm::vec3(0, 1, 0);
 
-        // Obj File Name
-        string objFileName = "sphere.obj";
+        // Occlusion Culling (CPU depth buffer of each model's largest triangles, tested before drawing)
+        bool occlusionCulling = false;
+        int occlusionBufferWidth = 256;
+        int occlusionBufferHeight = 192;
+        int occludersPerModel = 64;
+
+        // Frame Scheduling (continuous rendering redraws every frame for benchmarking)
+        bool continuousRendering = false;
+        bool vsync = true;
+        double targetFrameRate = 0;
+        double inputTimeStep = 1.0 / 120.0;
+        double idleWaitTimeout = 0.5;
+
+        // Frame Capture (reads frames back through a ring of pixel buffers, written by a background thread as
+        // <prefix><frame>.ppm/.png or appended to <prefix><width>x<height>.rgba, a full queue drops or blocks)
+        // The window can't be resized while capturing
+        bool frameCapture = false;
+        FrameCapture::Format captureFormat = FrameCapture::Format::PPM;
+        FrameCapture::Policy capturePolicy = FrameCapture::Policy::Drop;
+        int captureRingSize = 3;
+        int captureQueueDepth = 8;
+        string capturePrefix = "capture_";
+
+        // Capture Benchmark (hidden window, renders continuously without then with capture and compares frame times)
+        // Warm-up frames are not timed, and writing the frames left at the end counts towards capture
+        bool captureBenchmark = false;
+        int captureBenchmarkWarmupFrames = 50;
+        int captureBenchmarkFrames = 200;
+
+        // Input Trace (Record saves the keys of every input step, Replay renders one frame per recorded step in a hidden
+        // window with vsync off, so modes can be compared on the same poses, and appends its frame times to the report)
+        InputTrace::Mode inputTraceMode = InputTrace::Mode::Live;
+        string inputTraceFileName = "inputTrace.txt";
+        string inputTraceReportFileName = "inputTraceReport.csv";
+
+        // Obj File Names (each is a child of the root node, placed at its offset)
+        vector<string> objFileNames = {"sphere.obj"};
+        vector<glm::vec3> objOffsets = {glm::vec3(0, 0, 0)};
+
+        // Scene Benchmark (headless, runs instead of opening the window)
+        bool sceneBenchmark = false;
+        int sceneBenchmarkNodes = 100000;
+        int sceneBenchmarkFrames = 100;
+        float sceneBenchmarkDirtyFraction = 0.01f;
+
+        // Normal Benchmark (headless, grid of 2 * size * size triangles, 0 threads for all)
+        bool normalBenchmark = false;
+        int normalBenchmarkGridSize = 2300;
+        int normalBenchmarkMaxThreads = 0;
+
+        // Half-Edge Benchmark (headless, grid of 2 * size * size triangles, 0 threads for all)
+        bool halfEdgeBenchmark = false;
+        int halfEdgeBenchmarkGridSize = 2237;
+        int halfEdgeBenchmarkMaxThreads = 0;
+
+        // Compression Benchmark (headless, writes <obj>.mtcm for each OBJ File and tests a grid)
+        bool compressionBenchmark = false;
+        int compressionBenchmarkGridSize = 1000;
+        int compressionBenchmarkDecodes = 20;
+
+        // Regression Harness (hidden window, preferring a software EGL/OSMesa context, renders each OBJ File
+        // and a grid at every pose in every shading and z buffer mode, exits with 1 when an image or metric regresses)
+        // Missing golden images or baseline fail, recording overwrites them with this run's images and metrics
+        // The grid is scaled to the sphere's size, as a unit grid at the center is past the far clipping plane
+        // Frame time metrics regress when over the baseline by both the threshold and the minimum difference (microseconds),
+        // and are only compared with a baseline recorded on the same renderer and build type
+        // Exits with the skip code when no OpenGL context can be made, even on GLFW's null platform
+        bool regressionHarness = false;
+        bool regressionRecord = false;
+        int regressionWidth = 256;
+        int regressionHeight = 192;
+        int regressionFrames = 20;
+        int regressionGridSize = 32;
+        float regressionGridScale = 10;
+        vector<glm::vec3> regressionPoseAngles = {glm::vec3(-45, 0, 0), glm::vec3(30, 60, 15)};
+        string goldenPrefix = "golden_";
+        int goldenChannelTolerance = 8;
+        float goldenMaxDifferentPixels = 0.002f;
+        float regressionThreshold = 0.25f;
+        double regressionMinimumDifference = 1000;
+        string regressionBaselineFileName = "regressionBaseline.json";
+        string regressionMetricsFileName = "regressionMetrics.json";
+        // Directories of the goldens and baseline, and of the metrics and failed images (empty is the working directory)
+        string regressionGoldenDirectory = "";
+        string regressionOutputDirectory = "";
+        int regressionSkipCode = 77;
+
+        // Transform Benchmark (times each transform mode over poses of a large grid, then closes the window)
+        bool transformBenchmark = false;
+        int transformBenchmarkGridSize = 1000;
+        int transformBenchmarkPoses = 50;
 
         // File Name of Shader Files
         string vertexShaderFileName = "source.vs";
         string fragmentShaderFileName = "source.fs";
+        vector<string> shaderDefines = {};
+
+        // Transform feedback program, verified against the CPU transform on its first pass
+        string transformShaderFileName = "transform.vs";
+        vector<string> transformFeedbackVaryings = {"tfPosition", "tfColor", "tfNormal"};
+        bool verifyTransformFeedback = true;
+
+        // Linked shader programs are cached in files starting with this prefix
+        bool useShaderCache = true;
+        string shaderCachePrefix = "shaderCache_";
 
         // Uniform Constants
         const char* vertexMatrixUniformName = "matrix";
@@ -72,12 +229,77 @@ int main() {
         const char* phongExponentUniformName = "phongExponent";
         const char* lightVecUniformName = "lightVec";
         const char* specularColorUniformName = "specularColor";
+        const char* modelViewMatrixUniformName = "modelViewMatrix";
+        const char* normalMatrixUniformName = "normalMatrix";
+        const char* pointLightsEnabledUniformName = "pointLightsEnabled";
+        const char* pointLightDataUniformName = "pointLightData";
+        const char* clusterGridUniformName = "clusterGrid";
+        const char* clusterLightIndicesUniformName = "clusterLightIndices";
+        const char* clusterCountsUniformName = "clusterCounts";
+        const char* viewportSizeUniformName = "viewportSize";
+
+    unsigned int shaderProgram;
+
+    // Command Line
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        if (argument == "--regression") {
+            regressionHarness = true;
+        }
+        else if (argument == "--record-goldens") {
+            regressionHarness = true;
+            regressionRecord = true;
+        }
+        else if (argument == "--golden-dir" && i + 1 < argc) {
+            regressionGoldenDirectory = argv[++i];
+        }
+        else if (argument == "--output-dir" && i + 1 < argc) {
+            regressionOutputDirectory = argv[++i];
+        }
+        else {
+            cout << "Unknown argument: \'" << argument << "\', expected --regression, --record-goldens, --golden-dir <dir> or --output-dir <dir>." << endl;
+            return 2;
+        }
+    }
 
-    char* vertexShaderSource = nullptr;
-    char* fragmentShaderSource = nullptr;
-    unsigned int VBO, VAO, EBO, shaderProgram;
+    if (sceneBenchmark) {
+        runSceneBenchmark(sceneBenchmarkNodes, sceneBenchmarkFrames, sceneBenchmarkDirtyFraction);
+        return 0;
+    }
+    if (normalBenchmark) {
+        runNormalBenchmark(normalBenchmarkGridSize, normalBenchmarkMaxThreads);
+        return 0;
+    }
+    if (halfEdgeBenchmark) {
+        runHalfEdgeBenchmark(halfEdgeBenchmarkGridSize, halfEdgeBenchmarkMaxThreads);
+        return 0;
+    }
+    if (compressionBenchmark) {
+        for (int i = 0; i < objFileNames.size(); i++) {
+            ifstream objFile(objFileNames.at(i), ios::binary | ios::ate);
+            Model model = Model(objFileNames.at(i));
+            runCompressionBenchmark(&model, objFileNames.at(i), objFile.is_open() ? (size_t) objFile.tellg() : 0, compressionBenchmarkDecodes);
+        }
+
+        Model* grid = Model::generateGrid(compressionBenchmarkGridSize, compressionBenchmarkGridSize);
+        runCompressionBenchmark(grid, "", 0, compressionBenchmarkDecodes);
+        delete grid;
+        return 0;
+    }
 
     // Handle contradictory settings
+    if (regressionHarness) {
+        // Every mode is rendered by the harness with the GPU matrix, without lights or culling
+        transformMode = transformation::GPU;
+        transformBenchmark = false;
+        occlusionCulling = false;
+        numPointLights = 0;
+        lightBenchmark = false;
+        zBufferRenderMode = zBuffer::None;
+        frameCapture = false;
+        captureBenchmark = false;
+        inputTraceMode = InputTrace::Mode::Live;
+    }
     if (zBufferRenderMode != zBuffer::None && shadingMode != shading::None) {
         cout << "Currently rendering Z Buffer, setting shading mode to None." << endl;
         shadingMode = shading::None;
@@ -86,101 +308,203 @@ int main() {
         cout << "Cannot do flat shading with EBO Mode On, turning EBO Mode off." << endl;
         useEBO = false;
     }
+    if (lightBenchmark) {
+        continuousRendering = true;
+        numPointLights = lightBenchmarkCounts.empty() ? 0 : lightBenchmarkCounts.at(0);
+    }
+    if (captureBenchmark) {
+        continuousRendering = true;
+        vsync = false;
+        frameCapture = false;
+        lightBenchmark = false;
+    }
+    InputTrace inputTrace(inputTraceMode, inputTraceFileName, inputTimeStep);
+    bool replaying = inputTrace.getMode() == InputTrace::Mode::Replay;
+    if (replaying) {
+        continuousRendering = true;
+        vsync = false;
+        targetFrameRate = 0;
+    }
+    bool usePointLights = numPointLights > 0 || lightBenchmark;
+    if (usePointLights && transformMode != transformation::GPU) {
+        cout << "Point lights need view space positions from the GPU matrix, turning point lights off." << endl;
+        usePointLights = false;
+        lightBenchmark = false;
+    }
 
     // Initialize
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "viewGL", NULL, NULL);
+    bool headless = regressionHarness || captureBenchmark || replaying;
+    auto createWindow = [&]() -> GLFWwindow* {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        if (regressionHarness) {
+            return createHiddenWindow(regressionWidth, regressionHeight);
+        }
+        if (headless) {
+            return createHiddenWindow(SCR_WIDTH, SCR_HEIGHT);
+        }
+
+        // Captured frames are all the size of the framebuffer when capture starts
+        glfwWindowHint(GLFW_RESIZABLE, frameCapture ? GLFW_FALSE : GLFW_TRUE);
+        return glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "viewGL", NULL, NULL);
+    };
+    bool initialized = glfwInit() == GLFW_TRUE;
+    GLFWwindow* window = initialized ? createWindow() : NULL;
+#ifdef GLFW_PLATFORM_NULL
+    // Without a display the headless modes retry on GLFW's null platform, which makes a surfaceless EGL or OSMesa context
+    if (window == NULL && headless) {
+        glfwTerminate();
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+        initialized = glfwInit() == GLFW_TRUE;
+        window = initialized ? createWindow() : NULL;
+    }
+#endif
     if (window == NULL) {
-        cout << "Failed to create GLFW window" << endl;
+        cout << (initialized ? "Failed to create GLFW window" : "Failed to initialize GLFW") << endl;
         glfwTerminate();
-        return -1;
+
+        // CTest counts the regression harness as skipped rather than failed when there is no OpenGL context
+        return regressionHarness ? regressionSkipCode : -1;
     }
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSwapInterval(vsync ? 1 : 0);
     glewInit();
 
-    // Create Vertex Shader
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    vertexShaderSource = Model::readShader(vertexShaderFileName);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << endl;
-    }
-
-    // Create Fragment Shader
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    fragmentShaderSource = Model::readShader(fragmentShaderFileName);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
+    // Load Shader Program (from the cache when the sources and driver match, the regression harness always
+    // compiles so its shader.load metric does not depend on what is cached)
+    auto shaderStart = chrono::high_resolution_clock::now();
+    ShaderManager shaderManager(useShaderCache && !regressionHarness, shaderCachePrefix);
+    shaderProgram = shaderManager.loadProgram(vertexShaderFileName, fragmentShaderFileName, shaderDefines);
+    auto shaderFinish = chrono::high_resolution_clock::now();
 
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << endl;
+    if (outputPerformanceTime) {
+        long duration = chrono::duration_cast<chrono::microseconds>(shaderFinish - shaderStart).count();
+        cout << "Shader Program (" << (!useShaderCache ? "cache off" : shaderManager.wasCacheHit() ? "cache hit" : "cache miss") << "): " << duration << " microseconds." << endl;
     }
 
-    // Link shaders
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << endl;
+    // Load Transform Feedback Program
+    unsigned int transformProgram = 0;
+    unsigned int uniformTransformMatrixID = 0;
+    if (transformMode == transformation::Feedback || transformBenchmark) {
+        transformProgram = shaderManager.loadFeedbackProgram(transformShaderFileName, transformFeedbackVaryings, shaderDefines);
+        uniformTransformMatrixID = glGetUniformLocation(transformProgram, vertexMatrixUniformName);
     }
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
 
     // Enable Depth Drawing
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LESS);
 
-    // Create Model
-    Model model = Model(objFileName);
-    model.translate = translate;
-    model.angleX = angleX;
-    model.angleY = angleY;
-    model.angleZ = angleZ;
-    model.scale = scale;
-    model.fov = fov;
-    model.aspectRatio = SCR_WIDTH / SCR_HEIGHT;
-    model.nearClippingPlane = nearClippingPlane;
-    model.farClippingPlane = farClippingPlane;
-    model.aspectRatio = aspectRatio;
-    model.defaultColor = defaultColor;
-    model.cameraTarget = cameraTarget;
-    model.cameraPosition = cameraPosition;
-    model.upVec = upVec;
+    // Create Scene (input moves the root node)
+    Scene scene;
+    scene.fov = fov;
+    scene.nearClippingPlane = nearClippingPlane;
+    scene.farClippingPlane = farClippingPlane;
+    scene.aspectRatio = aspectRatio;
+    scene.cameraTarget = cameraTarget;
+    scene.cameraPosition = cameraPosition;
+    scene.upVec = upVec;
+
+    int rootNode = scene.addNode(-1, -1);
+    scene.setTranslate(rootNode, translate);
+    scene.setAngles(rootNode, glm::vec3(angleX, angleY, angleZ));
+    scene.setScale(rootNode, scale);
+
+    // Load each model into a child node
+    vector<string> modelNames;
+    vector<long> modelLoadTimes;
+    for (int i = 0; i < objFileNames.size(); i++) {
+        auto loadStart = chrono::high_resolution_clock::now();
+        int modelIndex = scene.addModel(objFileNames.at(i));
+        auto loadFinish = chrono::high_resolution_clock::now();
+        modelNames.push_back(objFileNames.at(i).substr(0, objFileNames.at(i).rfind('.')));
+        modelLoadTimes.push_back(chrono::duration_cast<chrono::microseconds>(loadFinish - loadStart).count());
+
+        Model* model = scene.getModel(modelIndex);
+        model->defaultColor = defaultColor;
+        model->useFileNormals = useFileNormals;
+
+        // Report what loading read, and anything it had to repair
+        LoadStatistics statistics = model->getLoadStatistics();
+        int numRepairs = statistics.numInvalidLines + statistics.numInvalidFaces + statistics.numInvalidAttributes + statistics.numDegenerateTriangles + statistics.numUnreferencedVertices;
+        if (outputPerformanceTime || numRepairs > 0) {
+            cout << "Model '" << objFileNames.at(i) << "': " << statistics.numVertices << " vertices, " << statistics.numFaces << " faces, " << statistics.numTriangles << " triangles, " << statistics.numRelativeIndices << " relative indices, " << statistics.numChunks << " chunks, " << statistics.loadTime << " microseconds." << endl;
+        }
+        if (numRepairs > 0) {
+            cout << "Model '" << objFileNames.at(i) << "' repaired: " << statistics.numInvalidLines << " invalid lines, " << statistics.numInvalidFaces << " invalid faces, " << statistics.numInvalidAttributes << " invalid texture/normal indices, ";
+            cout << statistics.numDegenerateTriangles << " degenerate triangles, " << statistics.numUnreferencedVertices << " unreferenced vertices." << endl;
+        }
+
+        int node = scene.addNode(rootNode, modelIndex);
+        if (i < objOffsets.size()) {
+            scene.setTranslate(node, objOffsets.at(i));
+        }
+    }
+
+    // The harness also renders a generated grid
+    if (regressionHarness) {
+        auto loadStart = chrono::high_resolution_clock::now();
+        Model* grid = Model::generateGrid(regressionGridSize, regressionGridSize);
+        auto loadFinish = chrono::high_resolution_clock::now();
+        grid->defaultColor = defaultColor;
+        modelNames.push_back("grid");
+        modelLoadTimes.push_back(chrono::duration_cast<chrono::microseconds>(loadFinish - loadStart).count());
+        int gridNode = scene.addNode(rootNode, scene.addModel(grid));
+        scene.setScale(gridNode, glm::vec3(regressionGridScale, regressionGridScale, regressionGridScale));
+    }
+    scene.update();
+
+    // Occluder triangles and bounding box of each model
+    OcclusionCuller occlusionCuller(occlusionBufferWidth, occlusionBufferHeight);
+    vector<vector<glm::vec3>> modelOccluders;
+    vector<pair<glm::vec3, glm::vec3>> modelBounds;
+    for (int i = 0; i < scene.getNumModels(); i++) {
+        modelOccluders.push_back(scene.getModel(i)->getOccluderTriangles(occludersPerModel));
+        modelBounds.push_back(scene.getModel(i)->getBoundingBox());
+    }
 
     // Timing
     long frame = 1;
     long average = 0;
 
-    // Calculate Vertices/Indices of Model
-    float* vertices = nullptr;
-    unsigned int* indices = nullptr;
-    if (useEBO) {
-        pair<float*, unsigned int*> result = model.generateEBOVerticesArray(cpuMatrix, colorModifier, shadingMode != shading::None);
-        vertices = result.first;
-        indices = result.second;
-    } else {
-        vertices = model.generateVBOVerticesArray(cpuMatrix, colorModifier, shadingMode == shading::Flat, shadingMode != shading::None);
+    // Calculate Vertices/Indices of each Model and create its VAO, VBO, and EBO
+    auto generateStart = chrono::high_resolution_clock::now();
+    vector<NodeBuffers> nodeBuffers;
+    for (int i = 0; i < scene.getNumNodes(); i++) {
+        if (scene.getNodeModel(i) < 0) {
+            continue;
+        }
+
+        NodeBuffers buffers;
+        buffers.node = i;
+        glGenVertexArrays(1, &buffers.VAO);
+        glGenBuffers(1, &buffers.VBO);
+        glGenBuffers(1, &buffers.EBO);
+        Model* model = scene.getModel(scene.getNodeModel(i));
+        uploadNodeBuffers(&buffers, model, transformMode == transformation::CPU ? scene.getMatrix(i) : glm::mat4(1), useEBO, colorModifier, shadingMode);
+
+        // Transform once now, then only when the node moves
+        if (transformMode == transformation::Feedback) {
+            createFeedbackBuffers(&buffers, model, useEBO);
+            runTransformFeedback(&buffers, model, useEBO, transformProgram, uniformTransformMatrixID, scene.getMatrix(i));
+            if (verifyTransformFeedback) {
+                cout << "Transform Feedback (node " << i << "): max difference from the CPU transform " << compareTransformFeedback(&buffers, model, useEBO, scene.getMatrix(i)) << endl;
+            }
+        }
+        nodeBuffers.push_back(buffers);
     }
+    auto generateFinish = chrono::high_resolution_clock::now();
 
-    // Create a Uniform Matrix
+    // Compare with useFileNormals off to see the cost of computing normals
+    if (outputPerformanceTime) {
+        long duration = chrono::duration_cast<chrono::microseconds>(generateFinish - generateStart).count();
+        cout << "Vertex Generation (" << (useFileNormals ? "file" : "computed") << " normals): " << duration << " microseconds." << endl;
+    }
+
+    // Create a Uniform Matrix (set per node when drawing)
     unsigned int uniformMatrixID = glGetUniformLocation(shaderProgram, vertexMatrixUniformName);
-    glm::mat4 matrixToUse = cpuMatrix ? glm::mat4(1) : model.getMatrix();
+    glm::mat4 matrixToUse = glm::mat4(1);
     glUseProgram(shaderProgram);
     glUniformMatrix4fv(uniformMatrixID, 1, false, &matrixToUse[0][0]);
 
@@ -218,37 +542,92 @@ int main() {
     unsigned int uniformSpecularColorID = glGetUniformLocation(shaderProgram, specularColorUniformName);
     glUniform3fv(uniformSpecularColorID, 1, &specularColor[0]);
 
-    // Create VAO, VBO, and EBO
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-
-    // Create VBO
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, model.getNumVertices(useEBO) * 11 * sizeof(float), vertices, GL_STATIC_DRAW);
-
-    // Vertices for VBO
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*) 0);
-    glEnableVertexAttribArray(0);
-
-    // Colors for VBO
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*) (4 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    // Add the point light uniforms (texture buffer units 0 to 2)
+    unsigned int uniformModelViewMatrixID = glGetUniformLocation(shaderProgram, modelViewMatrixUniformName);
+    unsigned int uniformNormalMatrixID = glGetUniformLocation(shaderProgram, normalMatrixUniformName);
+    unsigned int uniformViewportSizeID = glGetUniformLocation(shaderProgram, viewportSizeUniformName);
+    glUniform1i(glGetUniformLocation(shaderProgram, pointLightsEnabledUniformName), usePointLights ? 1 : 0);
+    glUniform1i(glGetUniformLocation(shaderProgram, pointLightDataUniformName), 0);
+    glUniform1i(glGetUniformLocation(shaderProgram, clusterGridUniformName), 1);
+    glUniform1i(glGetUniformLocation(shaderProgram, clusterLightIndicesUniformName), 2);
+    glUniform3i(glGetUniformLocation(shaderProgram, clusterCountsUniformName), clusterCounts.x, clusterCounts.y, clusterCounts.z);
+
+    // Texture buffers for the light data, cluster offset/counts, and light indices
+    LightClusters lightClusters(clusterCounts.x, clusterCounts.y, clusterCounts.z, 0);
+    vector<LightClusters::PointLight> pointLights = generatePointLights(numPointLights, pointLightCenter, pointLightSpread, pointLightRadius, pointLightIntensity);
+    unsigned int lightBuffers[3], lightTextures[3];
+    GLenum lightFormats[3] = {GL_RGBA32F, GL_RG32UI, GL_R32UI};
+    glGenBuffers(3, lightBuffers);
+    glGenTextures(3, lightTextures);
+    for (int i = 0; i < 3; i++) {
+        glBindBuffer(GL_TEXTURE_BUFFER, lightBuffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, 4 * sizeof(float), nullptr, GL_STREAM_DRAW);
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_BUFFER, lightTextures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, lightFormats[i], lightBuffers[i]);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    int maxTextureBufferSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTextureBufferSize);
+    lightClusters.setMaxLightIndices(maxTextureBufferSize);
+
+    // Light Benchmark Progress
+    int lightBenchmarkStep = 0;
+    int lightBenchmarkFrame = 0;
+    long lightBenchmarkFrameTime = 0;
+    long lightBenchmarkAssignTime = 0;
+
+    // Render every mode to compare with the goldens and baseline instead of opening the window
+    int exitCode = 0;
+    if (regressionHarness) {
+        auto inDirectory = [](string directory, string fileName) {
+            return directory.empty() ? fileName : directory + "/" + fileName;
+        };
+        RegressionHarness harness(inDirectory(regressionGoldenDirectory, goldenPrefix), inDirectory(regressionOutputDirectory, goldenPrefix), goldenChannelTolerance, goldenMaxDifferentPixels, regressionThreshold, regressionMinimumDifference, regressionRecord);
+        harness.setRenderer(string((const char*) glGetString(GL_RENDERER)));
+        if (!regressionRecord) {
+            harness.loadBaseline(inDirectory(regressionGoldenDirectory, regressionBaselineFileName));
+        }
+        string buildType = string(MODEL_TRANSFORMER_BUILD_TYPE).empty() ? "none" : MODEL_TRANSFORMER_BUILD_TYPE;
+        harness.setBuildType(buildType);
+        cout << "Regression: renderer " << glGetString(GL_RENDERER) << ", build type " << buildType << endl;
+
+        // CPU side timings swing with the optimization level and the file system, so they are recorded but not gated
+        harness.addMetric("shader.load", chrono::duration_cast<chrono::microseconds>(shaderFinish - shaderStart).count(), false);
+        harness.addMetric("vertexGeneration", chrono::duration_cast<chrono::microseconds>(generateFinish - generateStart).count(), false);
+        for (int i = 0; i < modelNames.size(); i++) {
+            harness.addMetric(modelNames.at(i) + ".load", modelLoadTimes.at(i), false);
+        }
 
-    // Normals for VBO
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*) (8 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+        bool rendered = runRegressionHarness(&harness, &scene, rootNode, &nodeBuffers, modelNames, regressionPoseAngles, regressionWidth, regressionHeight, regressionFrames, colorModifier, backgroundColor, uniformMatrixID, uniformZBufferRenderModeID, uniformShadingModeID);
+        harness.checkMetrics();
+        harness.writeMetrics(regressionRecord ? inDirectory(regressionGoldenDirectory, regressionBaselineFileName) : inDirectory(regressionOutputDirectory, regressionMetricsFileName));
+        harness.printSummary();
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+        exitCode = rendered && harness.passed() ? 0 : 1;
+        glfwSetWindowShouldClose(window, true);
+    }
 
-    // Indices for EBO
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, model.getNumIndices() * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+    // Compare the transform modes on a large grid instead of opening the window
+    if (transformBenchmark) {
+        runTransformBenchmark(transformBenchmarkGridSize, transformBenchmarkPoses, scene.getMatrix(rootNode), useEBO, colorModifier, shadingMode, shaderProgram, uniformMatrixID, transformProgram, uniformTransformMatrixID);
+        glfwSetWindowShouldClose(window, true);
+    }
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    // Frame Capture (the size of the framebuffer when it starts)
+    FrameCapture* capture = nullptr;
+    if (frameCapture || captureBenchmark) {
+        int captureWidth, captureHeight;
+        glfwGetFramebufferSize(window, &captureWidth, &captureHeight);
+        capture = new FrameCapture(captureWidth, captureHeight, captureRingSize, captureQueueDepth, captureFormat, capturePolicy, capturePrefix);
+    }
 
-    glBindVertexArray(0);
+    // Capture Benchmark Progress (frame times without, then with capture)
+    int captureBenchmarkFrame = 0;
+    long captureOffTime = 0;
+    long captureOnTime = 0;
 
     // Draw in wireframe polygons
     if (polygonMode) {
@@ -256,127 +635,284 @@ int main() {
     }
 
     // Render Loop
+    FrameScheduler scheduler(inputTimeStep, idleWaitTimeout, targetFrameRate, continuousRendering);
     bool renderFirst = true;
+    bool moving = false;
     while (!glfwWindowShouldClose(window)) {
-        if (renderFirst || processInput(window, &model, translationScaleStep, rotatationStep, fovStep)) {
+        // Integrate input in fixed steps of real time, or one recorded step per frame when replaying
+        bool move = false;
+        int inputSteps = replaying ? 1 : scheduler.beginFrame();
+        float timeStep = replaying ? inputTrace.getTimeStep() : scheduler.getInputTimeStep();
+        for (int i = 0; i < inputSteps; i++) {
+            unsigned int keys = inputTrace.next(window);
+            if (keys & (1u << InputTrace::Escape)) {
+                glfwSetWindowShouldClose(window, true);
+            }
+            if (processInput(keys, &scene, rootNode, translationScaleSpeed * timeStep, rotationSpeed * timeStep, fovSpeed * timeStep)) {
+                move = true;
+            }
+        }
+        if (inputTrace.isFinished()) {
+            glfwSetWindowShouldClose(window, true);
+        }
+
+        // Keep polling while keys are held, even on frames without a step
+        if (inputSteps > 0) {
+            moving = move;
+        }
+
+        if (renderFirst || move || continuousRendering) {
             renderFirst = false;
 
+            scheduler.startRender();
             auto start = chrono::high_resolution_clock::now();
-            // Update the Model
-            if (cpuMatrix) {
-                if (vertices != nullptr) {
-                    delete[] vertices;
+            // Update the Scene
+            scene.update();
+
+            // Update the Models
+            if (transformMode == transformation::CPU) {
+                // Remake the vertices/indices of nodes that moved
+                for (int i = 0; i < nodeBuffers.size(); i++) {
+                    NodeBuffers* buffers = &nodeBuffers.at(i);
+                    if (scene.hasChanged(buffers->node)) {
+                        uploadNodeBuffers(buffers, scene.getModel(scene.getNodeModel(buffers->node)), scene.getMatrix(buffers->node), useEBO, colorModifier, shadingMode);
+                    }
                 }
-
-                if (indices != nullptr) {
-                    delete[] indices;
-                }
-
-                // Remake the vertices/indices
-                if (useEBO) {
-                    pair<float*, unsigned int*> result = model.generateEBOVerticesArray(cpuMatrix, colorModifier, shadingMode != shading::None);
-                    vertices = result.first;
-                    indices = result.second;
-                } else {
-                    vertices = model.generateVBOVerticesArray(cpuMatrix, colorModifier, shadingMode == shading::Flat, shadingMode != shading::None);
+            }
+            else if (transformMode == transformation::Feedback) {
+                // Transform the vertices of nodes that moved on the GPU, keeping them there
+                for (int i = 0; i < nodeBuffers.size(); i++) {
+                    NodeBuffers* buffers = &nodeBuffers.at(i);
+                    if (scene.hasChanged(buffers->node)) {
+                        runTransformFeedback(buffers, scene.getModel(scene.getNodeModel(buffers->node)), useEBO, transformProgram, uniformTransformMatrixID, scene.getMatrix(buffers->node));
+                    }
                 }
+            }
 
-                // Create VBO
-                glBindVertexArray(VAO);
-                glBindBuffer(GL_ARRAY_BUFFER, VBO);
-                glBufferData(GL_ARRAY_BUFFER, model.getNumVertices(useEBO) * 11 * sizeof(float), vertices, GL_STATIC_DRAW);
-
-                // Vertices for VBO
-                glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*) 0);
-                glEnableVertexAttribArray(0);
+            // Background
+            glClearColor(backgroundColor.x, backgroundColor.y, backgroundColor.z, backgroundColor.w);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-                // Colors for VBO
-                glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*) (4 * sizeof(float)));
-                glEnableVertexAttribArray(1);
+            // Assign the point lights to clusters and upload them
+            if (usePointLights) {
+                lightClusters.setFrustum(scene.fov, scene.aspectRatio, scene.nearClippingPlane, scene.farClippingPlane);
+                lightClusters.assign(pointLights, scene.getViewMatrix());
+
+                // Never upload empty buffers
+                vector<float> lightData = lightClusters.getLightData();
+                vector<unsigned int> lightIndices = lightClusters.getLightIndices();
+                lightData.resize(max((int) lightData.size(), 8));
+                lightIndices.resize(max((int) lightIndices.size(), 1));
+                glBindBuffer(GL_TEXTURE_BUFFER, lightBuffers[0]);
+                glBufferData(GL_TEXTURE_BUFFER, lightData.size() * sizeof(float), lightData.data(), GL_STREAM_DRAW);
+                glBindBuffer(GL_TEXTURE_BUFFER, lightBuffers[1]);
+                glBufferData(GL_TEXTURE_BUFFER, lightClusters.getClusterGrid().size() * sizeof(unsigned int), lightClusters.getClusterGrid().data(), GL_STREAM_DRAW);
+                glBindBuffer(GL_TEXTURE_BUFFER, lightBuffers[2]);
+                glBufferData(GL_TEXTURE_BUFFER, lightIndices.size() * sizeof(unsigned int), lightIndices.data(), GL_STREAM_DRAW);
+                glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+                int viewportWidth, viewportHeight;
+                glfwGetFramebufferSize(window, &viewportWidth, &viewportHeight);
+                glUseProgram(shaderProgram);
+                glUniform2f(uniformViewportSizeID, (float) viewportWidth, (float) viewportHeight);
+            }
 
-                // Normals for VBO
-                glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*) (8 * sizeof(float)));
-                glEnableVertexAttribArray(2);
+            // Rasterize the occluders of every node
+            if (occlusionCulling) {
+                occlusionCuller.clear();
+                occlusionCuller.resetStatistics();
+                for (int i = 0; i < nodeBuffers.size(); i++) {
+                    int node = nodeBuffers.at(i).node;
+                    occlusionCuller.addOccluders(modelOccluders.at(scene.getNodeModel(node)), scene.getMatrix(node));
+                }
+                occlusionCuller.buildHierarchy();
+            }
 
-                glBindBuffer(GL_ARRAY_BUFFER, 0);
+            // Draw Triangles of each Node
+            glUseProgram(shaderProgram);
+            for (int i = 0; i < nodeBuffers.size(); i++) {
+                NodeBuffers* buffers = &nodeBuffers.at(i);
+                Model* model = scene.getModel(scene.getNodeModel(buffers->node));
+
+                // Skip nodes hidden behind the occluders
+                if (occlusionCulling) {
+                    pair<glm::vec3, glm::vec3> bounds = modelBounds.at(scene.getNodeModel(buffers->node));
+                    if (!occlusionCuller.isVisible(bounds.first, bounds.second, scene.getMatrix(buffers->node))) {
+                        continue;
+                    }
+                }
 
-                // Indices for EBO
-                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-                glBufferData(GL_ELEMENT_ARRAY_BUFFER, model.getNumIndices() * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+                // Update the Uniform Matrix
+                if (transformMode == transformation::GPU) {
+                    glUniformMatrix4fv(uniformMatrixID, 1, false, &scene.getMatrix(buffers->node)[0][0]);
+                }
 
-                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+                // View space matrices for the point lights
+                if (usePointLights) {
+                    glm::mat4 modelViewMatrix = scene.getViewMatrix() * scene.getWorldMatrix(buffers->node);
+                    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelViewMatrix)));
+                    glUniformMatrix4fv(uniformModelViewMatrixID, 1, false, &modelViewMatrix[0][0]);
+                    glUniformMatrix3fv(uniformNormalMatrixID, 1, false, &normalMatrix[0][0]);
+                }
 
-                glBindVertexArray(0);
-            }
-            // Update the Uniform Matrix
-            else {
-                glUseProgram(shaderProgram);
-                glUniformMatrix4fv(uniformMatrixID, 1, false, &model.getMatrix()[0][0]);
+                glBindVertexArray(transformMode == transformation::Feedback ? buffers->feedbackVAO : buffers->VAO);
+                if (useEBO) {
+                    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers->EBO);
+                    glDrawElements(GL_TRIANGLES, model->getNumIndices(), GL_UNSIGNED_INT, 0);
+                }
+                else {
+                    glDrawArrays(GL_TRIANGLES, 0, model->getNumVertices(useEBO));
+                }
             }
+            glBindVertexArray(0);
 
-            // Background
-            glClearColor(backgroundColor.x, backgroundColor.y, backgroundColor.z, backgroundColor.w);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-            // Draw Triangles
-            glUseProgram(shaderProgram);
-            glBindVertexArray(VAO);
-            if (useEBO) {
-                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-                glDrawElements(GL_TRIANGLES, model.getNumIndices(), GL_UNSIGNED_INT, 0);
+            // Read the back buffer before it is swapped
+            bool capturing = frameCapture || (captureBenchmark && captureBenchmarkFrame >= captureBenchmarkWarmupFrames + captureBenchmarkFrames);
+            if (capturing) {
+                capture->capture(frame);
             }
-            else {
-                glDrawArrays(GL_TRIANGLES, 0, model.getNumVertices(useEBO));
-            }
-            glBindVertexArray(0);
 
             glfwSwapBuffers(window);
 
             auto finish = chrono::high_resolution_clock::now();
 
+            // Time the same number of frames without and with capture, after the warm-up
+            if (captureBenchmark) {
+                long duration = chrono::duration_cast<chrono::microseconds>(finish - start).count();
+                if (capturing) {
+                    captureOnTime += duration;
+                }
+                else if (captureBenchmarkFrame >= captureBenchmarkWarmupFrames) {
+                    captureOffTime += duration;
+                }
+                captureBenchmarkFrame++;
+
+                if (captureBenchmarkFrame == captureBenchmarkWarmupFrames + captureBenchmarkFrames * 2) {
+                    auto finishStart = chrono::high_resolution_clock::now();
+                    capture->finish();
+                    auto finishEnd = chrono::high_resolution_clock::now();
+                    captureOnTime += chrono::duration_cast<chrono::microseconds>(finishEnd - finishStart).count();
+                    double offAverage = (double) captureOffTime / captureBenchmarkFrames;
+                    double onAverage = (double) captureOnTime / captureBenchmarkFrames;
+                    cout << "Capture Benchmark: renderer " << glGetString(GL_RENDERER) << endl;
+                    cout << "Capture Benchmark: capture off " << offAverage << " microseconds, capture on " << onAverage << " microseconds per frame, overhead " << (offAverage > 0 ? (onAverage - offAverage) / offAverage * 100 : 0) << "%." << endl;
+                    glfwSetWindowShouldClose(window, true);
+                }
+            }
+
+            // Average each light count, then move to the next
+            if (lightBenchmark) {
+                lightBenchmarkFrameTime += chrono::duration_cast<chrono::microseconds>(finish - start).count();
+                lightBenchmarkAssignTime += lightClusters.getAssignTime();
+                lightBenchmarkFrame++;
+
+                if (lightBenchmarkFrame == lightBenchmarkFrames) {
+                    cout << "Light Benchmark: " << pointLights.size() << " lights: frame " << lightBenchmarkFrameTime / lightBenchmarkFrames << " microseconds, assignment " << lightBenchmarkAssignTime / lightBenchmarkFrames << " microseconds, " << lightClusters.getLightIndices().size() << " cluster entries." << endl;
+                    lightBenchmarkFrame = 0;
+                    lightBenchmarkFrameTime = 0;
+                    lightBenchmarkAssignTime = 0;
+                    lightBenchmarkStep++;
+
+                    if (lightBenchmarkStep < lightBenchmarkCounts.size()) {
+                        pointLights = generatePointLights(lightBenchmarkCounts.at(lightBenchmarkStep), pointLightCenter, pointLightSpread, pointLightRadius, pointLightIntensity);
+                    }
+                    else {
+                        glfwSetWindowShouldClose(window, true);
+                    }
+                }
+            }
+
             if (outputPerformanceTime) {
                 long duration = chrono::duration_cast<chrono::microseconds>(finish - start).count();
                 cout << "Frame " << frame << ": " << duration << " microseconds." << endl;
                 average = (average * (frame - 1) + duration) / frame;
                 cout << "Average Time: " << average << " microseconds." << endl;
+
+                if (occlusionCulling) {
+                    cout << "Occlusion: " << occlusionCuller.getNumOccluded() << " occluded, " << occlusionCuller.getNumOutside() << " off screen of " << occlusionCuller.getNumTested() << " nodes, ";
+                    cout << occlusionCuller.getNumOccluderTriangles() << " occluder triangles, rasterize " << occlusionCuller.getRasterizeTime() << " microseconds, test " << occlusionCuller.getTestTime() << " microseconds." << endl;
+                }
+
+                if (capturing) {
+                    cout << "Frame Capture: " << capture->getNumCaptured() << " captured, " << capture->getNumWritten() << " written, " << capture->getNumDropped() << " dropped." << endl;
+                }
+
+                if (usePointLights) {
+                    cout << "Point Lights: " << pointLights.size() << " lights, " << lightClusters.getLightIndices().size() << " cluster entries, assignment " << lightClusters.getAssignTime() << " microseconds." << endl;
+                    if (lightClusters.getNumDropped() > 0) {
+                        cout << "Point Lights: " << lightClusters.getNumDropped() << " cluster entries dropped (texture buffer limit)." << endl;
+                    }
+                }
             }
 
             if (outputPosition) {
+                glm::vec3 position = scene.getTranslate(rootNode);
+                glm::vec3 rotation = scene.getAngles(rootNode);
+                glm::vec3 size = scene.getScale(rootNode);
                 cout << "Frame " << frame << ": " << endl;
                 cout << "Translation: " << endl;
-                cout << model.translate.x << " " << model.translate.y << " " << model.translate.z << endl;
+                cout << position.x << " " << position.y << " " << position.z << endl;
                 cout << "Rotation: " << endl;
-                cout << model.angleX << " " << model.angleY << " " << model.angleZ << endl;
+                cout << rotation.x << " " << rotation.y << " " << rotation.z << endl;
                 cout << "Scale: " << endl;
-                cout << model.scale.x << " " << model.scale.y << " " << model.scale.z << endl;
+                cout << size.x << " " << size.y << " " << size.z << endl;
                 cout << "FOV: " << endl;
-                cout << model.fov << endl;
+                cout << scene.fov << endl;
             }
 
             frame++;
+            scheduler.endRender(vsync);
         }
 
-        glfwPollEvents();
+        scheduler.waitForEvents(moving);
+    }
+
+    if (outputPerformanceTime) {
+        scheduler.printStatistics();
+    }
+
+    // Save the recorded keys, or report the replay's frame times with what was compared
+    inputTrace.save();
+    if (replaying) {
+        const char* transformNames[] = {"GPU", "CPU", "Feedback"};
+        const char* shadingNames[] = {"None", "Flat", "Gouraud", "Phong"};
+        string configuration = string(transformNames[(int) transformMode]) + " matrix " + (useEBO ? "EBO" : "VBO") + " " + shadingNames[(int) shadingMode] + " shading";
+        FrameScheduler::FrameStatistics statistics = scheduler.getFrameStatistics();
+        inputTrace.printReport(statistics);
+        inputTrace.writeReport(inputTraceReportFileName, configuration, statistics);
+    }
+
+    // Write the frames still being captured
+    if (capture != nullptr) {
+        capture->finish();
+        cout << "Frame Capture: " << capture->getNumCaptured() << " captured, " << capture->getNumWritten() << " written, " << capture->getNumDropped() << " dropped, ";
+        cout << "ring stalls " << capture->getStallTime() << " microseconds, queue blocked " << capture->getBlockTime() << " microseconds." << endl;
+        delete capture;
     }
 
     // Clean Up
-    if (vertexShaderSource != nullptr) {
-        delete[] vertexShaderSource;
+    for (int i = 0; i < nodeBuffers.size(); i++) {
+        glDeleteVertexArrays(1, &nodeBuffers.at(i).VAO);
+        glDeleteBuffers(1, &nodeBuffers.at(i).VBO);
+        glDeleteBuffers(1, &nodeBuffers.at(i).EBO);
+        if (nodeBuffers.at(i).feedbackVAO != 0) {
+            glDeleteVertexArrays(1, &nodeBuffers.at(i).feedbackVAO);
+            glDeleteBuffers(1, &nodeBuffers.at(i).feedbackVBO);
+        }
+        delete[] nodeBuffers.at(i).vertices;
+        if (nodeBuffers.at(i).indices != nullptr) {
+            delete[] nodeBuffers.at(i).indices;
+        }
     }
-    if (fragmentShaderSource != nullptr) {
-        delete[] fragmentShaderSource;
+    glDeleteBuffers(3, lightBuffers);
+    glDeleteTextures(3, lightTextures);
+    if (transformProgram != 0) {
+        glDeleteProgram(transformProgram);
     }
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
     glDeleteProgram(shaderProgram);
     glfwTerminate();
-    delete[] vertices;
-    if (indices != nullptr) {
-        delete[] indices;
-    }
 
-    return 0;
+    return exitCode;
 }
 
 // Callback for OpenGL
@@ -385,110 +921,647 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
 }
 
 // Process Input
-bool processInput(GLFWwindow* window, Model* model, float translationStep, float angleStep, float fovStep) {
-    // Exit Window on Escape
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-        glfwSetWindowShouldClose(window, true);
-    }
-
+bool processInput(unsigned int keys, Scene* scene, int node, float translationStep, float angleStep, float fovStep) {
     // Return True if Any Movement Occurred
     bool move = false;
+    glm::vec3 translate = scene->getTranslate(node);
+    glm::vec3 angles = scene->getAngles(node);
+    glm::vec3 scale = scene->getScale(node);
 
     // Move Model with Arrow Keys and Page Up/Down
-    if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) {
-        model->translate.y += translationStep;
+    if (keys & (1u << InputTrace::Up)) {
+        translate.y += translationStep;
         move = true;
     }
-    if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) {
-        model->translate.y -= translationStep;
+    if (keys & (1u << InputTrace::Down)) {
+        translate.y -= translationStep;
         move = true;
     }
-    if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
-        model->translate.x += translationStep;
+    if (keys & (1u << InputTrace::Left)) {
+        translate.x += translationStep;
         move = true;
     }
-    if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
-        model->translate.x -= translationStep;
+    if (keys & (1u << InputTrace::Right)) {
+        translate.x -= translationStep;
         move = true;
     }
-    if (glfwGetKey(window, GLFW_KEY_PAGE_UP) == GLFW_PRESS) {
-        model->translate.z += translationStep;
+    if (keys & (1u << InputTrace::PageUp)) {
+        translate.z += translationStep;
         move = true;
     }
-    if (glfwGetKey(window, GLFW_KEY_PAGE_DOWN) == GLFW_PRESS) {
-        model->translate.z -= translationStep;
+    if (keys & (1u << InputTrace::PageDown)) {
+        translate.z -= translationStep;
         move = true;
     }
 
     // Rotate Model around X Axis with R and T
-    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
-        model->angleX -= angleStep;
+    if (keys & (1u << InputTrace::RotateXMinus)) {
+        angles.x -= angleStep;
         move = true;
     }
-    if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS) {
-        model->angleX += angleStep;
+    if (keys & (1u << InputTrace::RotateXPlus)) {
+        angles.x += angleStep;
         move = true;
     }
 
     // Rotate Model around Y Axis with Y and U
-    if (glfwGetKey(window, GLFW_KEY_Y) == GLFW_PRESS) {
-        model->angleY -= angleStep;
+    if (keys & (1u << InputTrace::RotateYMinus)) {
+        angles.y -= angleStep;
         move = true;
     }
-    if (glfwGetKey(window, GLFW_KEY_U) == GLFW_PRESS) {
-        model->angleY += angleStep;
+    if (keys & (1u << InputTrace::RotateYPlus)) {
+        angles.y += angleStep;
         move = true;
     }
 
     // Rotate Model around Z Axis with I and O
-    if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS) {
-        model->angleZ -= angleStep;
+    if (keys & (1u << InputTrace::RotateZMinus)) {
+        angles.z -= angleStep;
         move = true;
     }
-    if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS) {
-        model->angleZ += angleStep;
+    if (keys & (1u << InputTrace::RotateZPlus)) {
+        angles.z += angleStep;
         move = true;
     }
 
     // Adjust Scale along X Axis with F and G
-    if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS) {
-        model->scale.x += translationStep;
+    if (keys & (1u << InputTrace::ScaleXPlus)) {
+        scale.x += translationStep;
         move = true;
     }
-    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS) {
-        model->scale.x -= translationStep;
+    if (keys & (1u << InputTrace::ScaleXMinus)) {
+        scale.x -= translationStep;
         move = true;
     }
 
     // Adjust Scale along Y Axis with H and J
-    if (glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS) {
-        model->scale.y += translationStep;
+    if (keys & (1u << InputTrace::ScaleYPlus)) {
+        scale.y += translationStep;
         move = true;
     }
-    if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS) {
-        model->scale.y -= translationStep;
+    if (keys & (1u << InputTrace::ScaleYMinus)) {
+        scale.y -= translationStep;
         move = true;
     }
 
     // Adjust Scale along Z Axis with K and L
-    if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS) {
-        model->scale.z += translationStep;
+    if (keys & (1u << InputTrace::ScaleZPlus)) {
+        scale.z += translationStep;
         move = true;
     }
-    if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS) {
-        model->scale.z -= translationStep;
+    if (keys & (1u << InputTrace::ScaleZMinus)) {
+        scale.z -= translationStep;
         move = true;
     }
 
     // Adjust FOV with Z and X
-    if (glfwGetKey(window, GLFW_KEY_Z)) {
-        model->fov = max(0.0f, model->fov - fovStep);
+    if (keys & (1u << InputTrace::FovMinus)) {
+        scene->fov = max(0.0f, scene->fov - fovStep);
         move = true;
     }
-    if (glfwGetKey(window, GLFW_KEY_X)) {
-        model->fov = min(180.0f, model->fov + fovStep);
+    if (keys & (1u << InputTrace::FovPlus)) {
+        scene->fov = min(180.0f, scene->fov + fovStep);
         move = true;
     }
 
+    // Only mark the node dirty when it moved
+    if (move) {
+        scene->setTranslate(node, translate);
+        scene->setAngles(node, angles);
+        scene->setScale(node, scale);
+    }
+
     return move;
-}
\ No newline at end of file
+}
+
+// Generate a model's vertices/indices with the given matrix and upload them to the node's buffers
+void uploadNodeBuffers(NodeBuffers* buffers, Model* model, glm::mat4 matrix, bool useEBO, bool colorModifier, shading shadingMode) {
+    if (buffers->vertices != nullptr) {
+        delete[] buffers->vertices;
+    }
+
+    if (buffers->indices != nullptr) {
+        delete[] buffers->indices;
+        buffers->indices = nullptr;
+    }
+
+    // Make the vertices/indices
+    if (useEBO) {
+        pair<float*, unsigned int*> result = model->generateEBOVerticesArray(matrix, colorModifier, shadingMode != shading::None);
+        buffers->vertices = result.first;
+        buffers->indices = result.second;
+    } else {
+        buffers->vertices = model->generateVBOVerticesArray(matrix, colorModifier, shadingMode == shading::Flat, shadingMode != shading::None);
+    }
+
+    // Create VBO
+    glBindVertexArray(buffers->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers->VBO);
+    glBufferData(GL_ARRAY_BUFFER, model->getNumVertices(useEBO) * 11 * sizeof(float), buffers->vertices, GL_STATIC_DRAW);
+    setVertexAttributes();
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Indices for EBO
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers->EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, model->getNumIndices() * sizeof(unsigned int), buffers->indices, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    glBindVertexArray(0);
+}
+
+// Interleaved vertex layout of the bound VBO
+void setVertexAttributes() {
+    // Vertices for VBO
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*) 0);
+    glEnableVertexAttribArray(0);
+
+    // Colors for VBO
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*) (4 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    // Normals for VBO
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*) (8 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+}
+
+// Feedback VBO in the same layout as the VBO, with a VAO to draw it
+void createFeedbackBuffers(NodeBuffers* buffers, Model* model, bool useEBO) {
+    glGenVertexArrays(1, &buffers->feedbackVAO);
+    glGenBuffers(1, &buffers->feedbackVBO);
+
+    glBindVertexArray(buffers->feedbackVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers->feedbackVBO);
+    glBufferData(GL_ARRAY_BUFFER, model->getNumVertices(useEBO) * 11 * sizeof(float), nullptr, GL_DYNAMIC_COPY);
+    setVertexAttributes();
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers->EBO);
+    glBindVertexArray(0);
+}
+
+// Transform every vertex of the VBO into the feedback VBO, drawing nothing
+void runTransformFeedback(NodeBuffers* buffers, Model* model, bool useEBO, unsigned int transformProgram, unsigned int uniformTransformMatrixID, glm::mat4 matrix) {
+    glUseProgram(transformProgram);
+    glUniformMatrix4fv(uniformTransformMatrixID, 1, false, &matrix[0][0]);
+
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(buffers->VAO);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffers->feedbackVBO);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, model->getNumVertices(useEBO));
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+}
+
+// Read back the feedback VBO and return its largest difference from the CPU transform of the VBO
+float compareTransformFeedback(NodeBuffers* buffers, Model* model, bool useEBO, glm::mat4 matrix) {
+    int numVertices = model->getNumVertices(useEBO);
+    vector<float> captured(numVertices * 11);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers->feedbackVBO);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, captured.size() * sizeof(float), captured.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    float maxDifference = 0;
+    for (int i = 0; i < numVertices; i++) {
+        float* source = &buffers->vertices[i * 11];
+        float* result = &captured[i * 11];
+
+        glm::vec4 position = matrix * glm::vec4(source[0], source[1], source[2], source[3]);
+        glm::vec3 normal = glm::vec3(source[8], source[9], source[10]);
+        if (normal != glm::vec3(0, 0, 0)) {
+            normal = glm::normalize(glm::vec3(matrix * glm::vec4(normal, 0)));
+        }
+
+        for (int j = 0; j < 4; j++) {
+            maxDifference = max(maxDifference, fabs(result[j] - position[j]));
+            maxDifference = max(maxDifference, fabs(result[4 + j] - source[4 + j]));
+        }
+        for (int j = 0; j < 3; j++) {
+            maxDifference = max(maxDifference, fabs(result[8 + j] - normal[j]));
+        }
+    }
+
+    return maxDifference;
+}
+
+// Time the CPU, GPU uniform and transform feedback modes over poses of a grid, each pose transformed then drawn
+void runTransformBenchmark(int gridSize, int numPoses, glm::mat4 baseMatrix, bool useEBO, bool colorModifier, shading shadingMode, unsigned int shaderProgram, unsigned int uniformMatrixID, unsigned int transformProgram, unsigned int uniformTransformMatrixID) {
+    Model* model = Model::generateGrid(gridSize, gridSize);
+    cout << "Transform Benchmark: " << model->getNumVertices(useEBO) << " vertices, " << numPoses << " poses." << endl;
+
+    NodeBuffers buffers;
+    glGenVertexArrays(1, &buffers.VAO);
+    glGenBuffers(1, &buffers.VBO);
+    glGenBuffers(1, &buffers.EBO);
+    uploadNodeBuffers(&buffers, model, glm::mat4(1), useEBO, colorModifier, shadingMode);
+    createFeedbackBuffers(&buffers, model, useEBO);
+
+    transformation modes[3] = {transformation::CPU, transformation::GPU, transformation::Feedback};
+    const char* modeNames[3] = {"CPU", "GPU uniform", "Transform feedback"};
+    glm::mat4 identity = glm::mat4(1);
+    for (int m = 0; m < 3; m++) {
+        long transformTotal = 0;
+        long frameTotal = 0;
+
+        for (int p = 0; p < numPoses; p++) {
+            glm::mat4 matrix = baseMatrix * glm::rotate(glm::mat4(1), glm::radians(360.0f * p / numPoses), glm::vec3(0, 1, 0));
+
+            // Transform (finished before timing so the draw is not included)
+            auto start = chrono::high_resolution_clock::now();
+            if (modes[m] == transformation::CPU) {
+                uploadNodeBuffers(&buffers, model, matrix, useEBO, colorModifier, shadingMode);
+            }
+            else if (modes[m] == transformation::Feedback) {
+                runTransformFeedback(&buffers, model, useEBO, transformProgram, uniformTransformMatrixID, matrix);
+            }
+            glFinish();
+            auto transformed = chrono::high_resolution_clock::now();
+
+            // Draw
+            glUseProgram(shaderProgram);
+            glUniformMatrix4fv(uniformMatrixID, 1, false, modes[m] == transformation::GPU ? &matrix[0][0] : &identity[0][0]);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glBindVertexArray(modes[m] == transformation::Feedback ? buffers.feedbackVAO : buffers.VAO);
+            if (useEBO) {
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.EBO);
+                glDrawElements(GL_TRIANGLES, model->getNumIndices(), GL_UNSIGNED_INT, 0);
+            }
+            else {
+                glDrawArrays(GL_TRIANGLES, 0, model->getNumVertices(useEBO));
+            }
+            glBindVertexArray(0);
+            glFinish();
+            auto finish = chrono::high_resolution_clock::now();
+
+            transformTotal += chrono::duration_cast<chrono::microseconds>(transformed - start).count();
+            frameTotal += chrono::duration_cast<chrono::microseconds>(finish - start).count();
+        }
+
+        cout << "Transform Benchmark: " << modeNames[m] << ": transform " << transformTotal / max(1, numPoses) << " microseconds, frame " << frameTotal / max(1, numPoses) << " microseconds per pose." << endl;
+
+        // CPU mode left transformed vertices in the VBO
+        if (modes[m] == transformation::CPU) {
+            uploadNodeBuffers(&buffers, model, glm::mat4(1), useEBO, colorModifier, shadingMode);
+        }
+    }
+
+    glm::mat4 lastMatrix = baseMatrix * glm::rotate(glm::mat4(1), glm::radians(360.0f * (numPoses - 1) / numPoses), glm::vec3(0, 1, 0));
+    cout << "Transform Benchmark: transform feedback max difference from the CPU transform " << compareTransformFeedback(&buffers, model, useEBO, lastMatrix) << endl;
+
+    glUseProgram(shaderProgram);
+    glUniformMatrix4fv(uniformMatrixID, 1, false, &identity[0][0]);
+    glDeleteVertexArrays(1, &buffers.VAO);
+    glDeleteVertexArrays(1, &buffers.feedbackVAO);
+    glDeleteBuffers(1, &buffers.VBO);
+    glDeleteBuffers(1, &buffers.EBO);
+    glDeleteBuffers(1, &buffers.feedbackVBO);
+    delete[] buffers.vertices;
+    delete[] buffers.indices;
+    delete model;
+}
+
+// Time scene updates of a large random hierarchy without a window
+void runSceneBenchmark(int numNodes, int numFrames, float dirtyFraction) {
+    mt19937 random(1234);
+    uniform_real_distribution<float> offset(-1.0f, 1.0f);
+
+    // Random hierarchy, every node's parent is an earlier node
+    Scene scene;
+    scene.reserveNodes(numNodes);
+    scene.addNode(-1, -1);
+    for (int i = 1; i < numNodes; i++) {
+        int node = scene.addNode(uniform_int_distribution<int>(0, i - 1)(random), -1);
+        scene.setTranslate(node, glm::vec3(offset(random), offset(random), offset(random)));
+    }
+
+    // First update calculates every node
+    auto start = chrono::high_resolution_clock::now();
+    scene.update();
+    auto finish = chrono::high_resolution_clock::now();
+    cout << "Scene Benchmark: " << numNodes << " nodes, full update: " << chrono::duration_cast<chrono::microseconds>(finish - start).count() << " microseconds." << endl;
+
+    // Move a fraction of the nodes each frame, and the root every 10th frame
+    int numDirty = max(1, (int) (numNodes * dirtyFraction));
+    vector<glm::mat4> matrices(numNodes);
+    long total = 0;
+    long worst = 0;
+    for (int frame = 0; frame < numFrames; frame++) {
+        for (int i = 0; i < numDirty; i++) {
+            int node = uniform_int_distribution<int>(0, numNodes - 1)(random);
+            scene.setAngles(node, scene.getAngles(node) + glm::vec3(0, 0.01f, 0));
+        }
+        if (frame % 10 == 0) {
+            scene.setAngles(0, scene.getAngles(0) + glm::vec3(0.01f, 0, 0));
+        }
+
+        start = chrono::high_resolution_clock::now();
+        scene.update();
+
+        // Gather every matrix as a draw submission would
+        for (int i = 0; i < numNodes; i++) {
+            matrices[i] = scene.getMatrix(i);
+        }
+        finish = chrono::high_resolution_clock::now();
+
+        long duration = chrono::duration_cast<chrono::microseconds>(finish - start).count();
+        total += duration;
+        worst = max(worst, duration);
+    }
+
+    long averageTime = total / max(1, numFrames);
+    cout << "Scene Benchmark: " << numDirty << " dirty nodes per frame, average: " << averageTime << " microseconds, worst: " << worst << " microseconds." << endl;
+    cout << "Scene Benchmark: " << (worst <= 16667 ? "within" : "over") << " a 60 FPS frame budget." << endl;
+}
+
+// Time smooth normal calculation with a doubling number of threads
+void runNormalBenchmark(int gridSize, int maxThreads) {
+    Model* model = Model::generateGrid(gridSize, gridSize);
+    int numVertices = model->getNumVertices(true);
+    cout << "Normal Benchmark: " << model->getNumIndices() / 3 << " triangles, " << numVertices << " vertices." << endl;
+
+    vector<glm::vec3> firstNormals;
+    long firstDuration = 0;
+    vector<int> threadCounts;
+    maxThreads = getNumThreads(maxThreads);
+    for (int threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (int t = 0; t < threadCounts.size(); t++) {
+        int threads = threadCounts.at(t);
+        auto start = chrono::high_resolution_clock::now();
+        model->computeSmoothNormals(threads);
+        auto finish = chrono::high_resolution_clock::now();
+        long duration = chrono::duration_cast<chrono::microseconds>(finish - start).count();
+
+        // Results must match the single threaded ones exactly
+        bool identical = true;
+        if (firstNormals.empty()) {
+            firstDuration = duration;
+            for (int i = 0; i < numVertices; i++) {
+                firstNormals.push_back(model->getNormal(i, false));
+            }
+        }
+        else {
+            for (int i = 0; i < numVertices && identical; i++) {
+                identical = model->getNormal(i, false) == firstNormals.at(i);
+            }
+        }
+
+        cout << "Normal Benchmark: " << threads << " threads: " << duration << " microseconds, speedup " << (double) firstDuration / max(1L, duration) << (identical ? "" : ", RESULTS DIFFER") << "." << endl;
+    }
+
+    delete model;
+}
+
+// Time building half-edges with a doubling number of threads, then traversing them
+void runHalfEdgeBenchmark(int gridSize, int maxThreads) {
+    Model* model = Model::generateGrid(gridSize, gridSize);
+    vector<int> triangleVertices = model->getTriangleVertices();
+    int numVertices = model->getNumPositions();
+    delete model;
+    cout << "Half-Edge Benchmark: " << triangleVertices.size() / 3 << " triangles, " << numVertices << " vertices." << endl;
+
+    vector<int> threadCounts;
+    maxThreads = getNumThreads(maxThreads);
+    for (int threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    HalfEdgeMesh* mesh = nullptr;
+    long firstDuration = 0;
+    for (int t = 0; t < threadCounts.size(); t++) {
+        delete mesh;
+        mesh = new HalfEdgeMesh(triangleVertices, numVertices, threadCounts.at(t));
+        if (t == 0) {
+            firstDuration = mesh->getBuildTime();
+        }
+        cout << "Half-Edge Benchmark: " << threadCounts.at(t) << " threads: build " << mesh->getBuildTime() << " microseconds, speedup " << (double) firstDuration / max(1L, mesh->getBuildTime()) << "." << endl;
+    }
+    cout << "Half-Edge Benchmark: " << (mesh->isManifold() ? "manifold" : "non-manifold") << ", " << mesh->getNumBoundaryHalfEdges() << " boundary half-edges, " << mesh->getNumNonManifoldEdges() << " non-manifold edges, " << mesh->getNumNonManifoldVertices() << " non-manifold vertices." << endl;
+
+    // One-ring of every vertex
+    long visited = 0;
+    long checksum = 0;
+    auto start = chrono::high_resolution_clock::now();
+    for (int i = 0; i < numVertices; i++) {
+        for (int halfEdge : mesh->aroundVertex(i)) {
+            checksum += mesh->target(halfEdge);
+            visited++;
+        }
+    }
+    auto finish = chrono::high_resolution_clock::now();
+    double seconds = chrono::duration_cast<chrono::duration<double>>(finish - start).count();
+    cout << "Half-Edge Benchmark: one-rings: " << visited << " half-edges, " << (seconds > 0 ? visited / seconds / 1e6 : 0) << " million per second." << endl;
+
+    // Face across every edge
+    visited = 0;
+    start = chrono::high_resolution_clock::now();
+    for (int i = 0; i < mesh->getNumFaces(); i++) {
+        for (int halfEdge : mesh->aroundFace(i)) {
+            checksum += mesh->isBoundary(halfEdge) ? -1 : mesh->face(mesh->twin(halfEdge));
+            visited++;
+        }
+    }
+    finish = chrono::high_resolution_clock::now();
+    seconds = chrono::duration_cast<chrono::duration<double>>(finish - start).count();
+    cout << "Half-Edge Benchmark: edge neighbors: " << visited << " half-edges, " << (seconds > 0 ? visited / seconds / 1e6 : 0) << " million per second." << endl;
+
+    // Boundary loops
+    start = chrono::high_resolution_clock::now();
+    vector<vector<int>> loops = mesh->getBoundaryLoops();
+    finish = chrono::high_resolution_clock::now();
+    long loopHalfEdges = 0;
+    for (int i = 0; i < loops.size(); i++) {
+        loopHalfEdges += loops.at(i).size();
+    }
+    cout << "Half-Edge Benchmark: " << loops.size() << " boundary loops of " << loopHalfEdges << " half-edges: " << chrono::duration_cast<chrono::microseconds>(finish - start).count() << " microseconds (checksum " << checksum << ")." << endl;
+
+    delete mesh;
+}
+
+// Compress a model, report the ratio, decode throughput and error, and save it next to the OBJ File
+void runCompressionBenchmark(Model* model, string name, size_t sourceSize, int numDecodes) {
+    CompressedMesh compressed(model);
+    pair<float*, unsigned int*> original = model->generateEBOVerticesArray(glm::mat4(1), false, true);
+
+    // Round trip through the file format
+    if (name != "") {
+        compressed.save(name + ".mtcm");
+        compressed = CompressedMesh(name + ".mtcm");
+    }
+    else {
+        name = "grid";
+    }
+
+    float* vertexArray = new float[compressed.getNumVertices() * 11];
+    unsigned int* indexArray = new unsigned int[compressed.getNumIndices()];
+    bool decoded = true;
+    auto start = chrono::high_resolution_clock::now();
+    for (int i = 0; i < numDecodes && decoded; i++) {
+        decoded = compressed.decode(vertexArray, indexArray);
+    }
+    auto finish = chrono::high_resolution_clock::now();
+    double seconds = chrono::duration_cast<chrono::duration<double>>(finish - start).count();
+
+    // Largest position/normal error, indices must be exact
+    float positionError = 0;
+    float normalError = 0;
+    bool indicesMatch = decoded;
+    for (int i = 0; i < compressed.getNumVertices(); i++) {
+        for (int j = 0; j < 3; j++) {
+            positionError = max(positionError, fabs(vertexArray[i * 11 + j] - original.first[i * 11 + j]));
+            normalError = max(normalError, fabs(vertexArray[i * 11 + 8 + j] - original.first[i * 11 + 8 + j]));
+        }
+    }
+    for (int i = 0; i < compressed.getNumIndices() && decoded; i++) {
+        indicesMatch = indicesMatch && indexArray[i] == original.second[i];
+    }
+
+    double decodedSize = compressed.getDecodedSize();
+    cout << "Compression Benchmark (" << name << "): " << compressed.getNumVertices() << " vertices, " << compressed.getNumIndices() << " indices." << endl;
+    if (sourceSize > 0) {
+        cout << "    OBJ File: " << sourceSize << " bytes, ratio " << (double) sourceSize / compressed.getCompressedSize() << ":1" << endl;
+    }
+    cout << "    In Memory: " << decodedSize << " bytes, compressed " << compressed.getCompressedSize() << " bytes, ratio " << decodedSize / compressed.getCompressedSize() << ":1" << endl;
+    cout << "    Decode: " << (seconds > 0 ? decodedSize * numDecodes / seconds / 1e9 : 0) << " GB/s" << endl;
+    cout << "    Max Error: position " << positionError << ", normal " << normalError << ", indices " << (!decoded ? "CORRUPT" : indicesMatch ? "exact" : "DIFFER") << endl;
+
+    delete[] vertexArray;
+    delete[] indexArray;
+    delete[] original.first;
+    delete[] original.second;
+}
+
+// Random point lights in a cube around the center
+vector<LightClusters::PointLight> generatePointLights(int numLights, glm::vec3 center, float spread, float radius, float intensity) {
+    mt19937 random(5678);
+    uniform_real_distribution<float> offset(-spread, spread);
+    uniform_real_distribution<float> color(0.2f, 1.0f);
+
+    vector<LightClusters::PointLight> lights;
+    for (int i = 0; i < numLights; i++) {
+        glm::vec3 position = center + glm::vec3(offset(random), offset(random), offset(random));
+        lights.push_back(LightClusters::PointLight(position, radius, glm::vec3(color(random), color(random), color(random)), intensity));
+    }
+
+    return lights;
+}
+
+// Hidden window for rendering without a display, tries an EGL context (Mesa llvmpipe with
+// LIBGL_ALWAYS_SOFTWARE=1), then OSMesa, then the native context
+GLFWwindow* createHiddenWindow(int width, int height) {
+    int contextAPIs[3] = {GLFW_EGL_CONTEXT_API, GLFW_OSMESA_CONTEXT_API, GLFW_NATIVE_CONTEXT_API};
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    for (int i = 0; i < 3; i++) {
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, contextAPIs[i]);
+        GLFWwindow* window = glfwCreateWindow(width, height, "viewGL", NULL, NULL);
+        if (window != NULL) {
+            return window;
+        }
+    }
+
+    return NULL;
+}
+
+// Render each model node alone at every pose in every mode into an offscreen framebuffer,
+// comparing the last frame with its golden image and adding the average frame time
+bool runRegressionHarness(RegressionHarness* harness, Scene* scene, int rootNode, vector<NodeBuffers>* nodeBuffers, vector<string> modelNames, vector<glm::vec3> poseAngles, int width, int height, int numFrames, bool colorModifier, glm::vec4 backgroundColor, unsigned int uniformMatrixID, unsigned int uniformZBufferRenderModeID, unsigned int uniformShadingModeID) {
+    // Every shading mode, and every z buffer mode (which is drawn without shading)
+    vector<pair<zBuffer, shading>> modes = {
+            {zBuffer::None, shading::None}, {zBuffer::None, shading::Flat}, {zBuffer::None, shading::Gouraud}, {zBuffer::None, shading::Phong},
+            {zBuffer::ZMode, shading::None}, {zBuffer::ZTildeMode, shading::None}, {zBuffer::ZPrimeMode, shading::None}};
+    const char* zBufferNames[4] = {"none", "z", "ztilde", "zprime"};
+    const char* shadingNames[4] = {"unshaded", "flat", "gouraud", "phong"};
+
+    // Offscreen framebuffer, so the size does not depend on the window system
+    unsigned int framebuffer, renderbuffers[2];
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(2, renderbuffers);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (!complete) {
+        cout << "Regression: offscreen framebuffer is incomplete." << endl;
+    }
+    glViewport(0, 0, width, height);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    vector<unsigned char> pixels(width * height * 3);
+    vector<unsigned char> flipped(width * height * 3);
+    bool passed = complete;
+    for (int n = 0; n < nodeBuffers->size() && complete; n++) {
+        NodeBuffers* buffers = &nodeBuffers->at(n);
+        Model* model = scene->getModel(scene->getNodeModel(buffers->node));
+        string modelName = modelNames.at(scene->getNodeModel(buffers->node));
+
+        for (int m = 0; m < modes.size(); m++) {
+            zBuffer zBufferRenderMode = modes.at(m).first;
+            shading shadingMode = modes.at(m).second;
+            bool useEBO = shadingMode != shading::Flat;
+            glUniform1i(uniformZBufferRenderModeID, (int) zBufferRenderMode);
+            glUniform1i(uniformShadingModeID, (int) shadingMode);
+            uploadNodeBuffers(buffers, model, glm::mat4(1), useEBO, colorModifier, shadingMode);
+
+            for (int p = 0; p < poseAngles.size(); p++) {
+                scene->setAngles(rootNode, poseAngles.at(p));
+                scene->update();
+
+                // The first frame is not timed (drivers may finish compiling on first use), the median
+                // frame time is kept so frames preempted by other processes do not count
+                vector<long> frameTimes;
+                for (int frame = 0; frame <= numFrames; frame++) {
+                    auto start = chrono::high_resolution_clock::now();
+                    glClearColor(backgroundColor.x, backgroundColor.y, backgroundColor.z, backgroundColor.w);
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                    glUniformMatrix4fv(uniformMatrixID, 1, false, &scene->getMatrix(buffers->node)[0][0]);
+                    glBindVertexArray(buffers->VAO);
+                    if (useEBO) {
+                        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers->EBO);
+                        glDrawElements(GL_TRIANGLES, model->getNumIndices(), GL_UNSIGNED_INT, 0);
+                    }
+                    else {
+                        glDrawArrays(GL_TRIANGLES, 0, model->getNumVertices(useEBO));
+                    }
+                    glBindVertexArray(0);
+                    glFinish();
+                    auto finish = chrono::high_resolution_clock::now();
+
+                    if (frame > 0) {
+                        frameTimes.push_back(chrono::duration_cast<chrono::microseconds>(finish - start).count());
+                    }
+                }
+
+                // Read back with the top row first
+                glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+                for (int y = 0; y < height; y++) {
+                    copy(pixels.begin() + y * width * 3, pixels.begin() + (y + 1) * width * 3, flipped.begin() + (height - 1 - y) * width * 3);
+                }
+
+                string caseName = modelName + "_pose" + to_string(p) + "_" + (zBufferRenderMode != zBuffer::None ? zBufferNames[(int) zBufferRenderMode] : shadingNames[(int) shadingMode]);
+                if (!harness->compareImage(caseName, width, height, flipped)) {
+                    passed = false;
+                }
+                sort(frameTimes.begin(), frameTimes.end());
+                harness->addMetric(caseName + ".frame", frameTimes.empty() ? 0 : frameTimes.at(frameTimes.size() / 2));
+            }
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteRenderbuffers(2, renderbuffers);
+    glDeleteFramebuffers(1, &framebuffer);
+    return passed;
+}
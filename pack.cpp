@@ -0,0 +1,291 @@
+#include "Model.h"
+#include "CompressedMesh.h"
+#include <filesystem>
+#include <atomic>
+#include <iomanip>
+#include <unordered_set>
+using namespace std;
+namespace fs = std::filesystem;
+
+// Asset and the hashes it was packed from (material files in mtllib order, relative to the OBJ File)
+struct ManifestEntry {
+    string objHash;
+    vector<pair<string, string>> materialHashes;
+};
+
+// Function Headers
+string hashFile(string fileName, size_t* size);
+map<string, ManifestEntry> readManifest(string fileName);
+bool writeManifest(string fileName, const map<string, ManifestEntry>& manifest);
+string packFileName(fs::path outputDirectory, string asset);
+
+// Version of the manifest and the packs, changing it repacks every asset
+static const string manifestHeader = "ModelTransformer_pack 2";
+
+// Entry Point: ModelTransformer_pack <asset directory> <pack directory> [threads]
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        cout << "Usage: " << argv[0] << " <asset directory> <pack directory> [threads]" << endl;
+        cout << "Packs every OBJ File under the asset directory, skipping ones whose OBJ and MTL files are unchanged." << endl;
+        return 1;
+    }
+
+    // Settings
+        fs::path assetDirectory = argv[1];
+        fs::path outputDirectory = argv[2];
+        int numThreads = argc > 3 ? atoi(argv[3]) : 0;
+        string manifestFileName = (outputDirectory / "manifest.txt").string();
+
+    auto start = chrono::high_resolution_clock::now();
+
+    // Find the OBJ Files, largest first so the long ones do not finish last
+    error_code error;
+    vector<pair<uintmax_t, string>> found;
+    fs::path outputCanonical = fs::weakly_canonical(outputDirectory, error);
+    for (fs::recursive_directory_iterator entry(assetDirectory, error), end; !error && entry != end; entry.increment(error)) {
+        error_code pathError;
+        if (entry->is_directory() && fs::weakly_canonical(entry->path(), pathError) == outputCanonical) {
+            entry.disable_recursion_pending();
+            continue;
+        }
+
+        string extension = entry->path().extension().string();
+        transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (entry->is_regular_file() && extension == ".obj") {
+            found.push_back(make_pair(entry->file_size(), fs::relative(entry->path(), assetDirectory).generic_string()));
+        }
+    }
+    if (error) {
+        cout << "Directory: \'" << assetDirectory.string() << "\' failed to open." << endl;
+        return 1;
+    }
+    sort(found.begin(), found.end(), greater<pair<uintmax_t, string>>());
+
+    vector<string> assets;
+    for (int i = 0; i < found.size(); i++) {
+        assets.push_back(found.at(i).second);
+    }
+
+    fs::create_directories(outputDirectory, error);
+    map<string, ManifestEntry> previous = readManifest(manifestFileName);
+
+    // Material files are often shared, so each is hashed once
+    mutex materialMutex;
+    map<string, pair<string, size_t>> materialHashes;
+    auto hashMaterial = [&](string fileName, size_t* size) {
+        {
+            lock_guard<mutex> lock(materialMutex);
+            auto cached = materialHashes.find(fileName);
+            if (cached != materialHashes.end()) {
+                *size = cached->second.second;
+                return cached->second.first;
+            }
+        }
+
+        string hash = hashFile(fileName, size);
+        lock_guard<mutex> lock(materialMutex);
+        materialHashes[fileName] = make_pair(hash, *size);
+        return hash;
+    };
+
+    // Results (entries stay empty for assets that failed), messages are printed in order after packing
+    vector<ManifestEntry> entries(assets.size());
+    vector<char> succeeded(assets.size(), 0);
+    vector<string> messages(assets.size());
+    atomic<int> numPacked(0);
+    atomic<int> numSkipped(0);
+    atomic<int> numEmpty(0);
+    atomic<int> numFailed(0);
+    atomic<long long> bytesRead(0);
+    atomic<long long> bytesWritten(0);
+
+    // One asset per item, loaded on its own thread as the assets already fill the pool
+    parallelForStealing(assets.size(), numThreads, [&](int index) {
+        string asset = assets.at(index);
+        fs::path objFileName = assetDirectory / asset;
+        fs::path objDirectory = objFileName.parent_path();
+        string packName = packFileName(outputDirectory, asset);
+        error_code fileError;
+
+        size_t objSize = 0;
+        ManifestEntry entry;
+        entry.objHash = hashFile(objFileName.string(), &objSize);
+        bytesRead += objSize;
+
+        // Skip when the OBJ File, every material file, and the pack are as they were
+        auto old = previous.find(asset);
+        if (old != previous.end() && old->second.objHash == entry.objHash && fs::exists(packName, fileError)) {
+            bool unchanged = true;
+            for (int i = 0; i < old->second.materialHashes.size() && unchanged; i++) {
+                size_t materialSize = 0;
+                string materialFileName = (objDirectory / old->second.materialHashes.at(i).first).lexically_normal().string();
+                unchanged = hashMaterial(materialFileName, &materialSize) == old->second.materialHashes.at(i).second;
+            }
+
+            if (unchanged) {
+                entries.at(index) = old->second;
+                succeeded.at(index) = 1;
+                numSkipped++;
+                return;
+            }
+        }
+
+        // The old pack is out of date whatever happens next, so it is removed when this one isn't written
+        if (entry.objHash == "missing") {
+            messages.at(index) = "File: \'" + objFileName.string() + "\' failed to open.";
+            fs::remove(packName, fileError);
+            numFailed++;
+            return;
+        }
+
+        // Parse, compute normals where the file has none, optimize the indices, and quantize
+        Model model(objFileName.string(), 1);
+        if (model.getNumIndices() == 0) {
+            messages.at(index) = "Pack: \'" + asset + "\' has no triangles, skipped.";
+            fs::remove(packName, fileError);
+            numEmpty++;
+            return;
+        }
+
+        vector<string> materialFiles = model.getMaterialFiles();
+        for (int i = 0; i < materialFiles.size(); i++) {
+            size_t materialSize = 0;
+            string materialFileName = fs::path(materialFiles.at(i)).lexically_normal().string();
+            string relativeName = fs::path(materialFiles.at(i)).lexically_relative(objDirectory).generic_string();
+            entry.materialHashes.push_back(make_pair(relativeName, hashMaterial(materialFileName, &materialSize)));
+            bytesRead += materialSize;
+        }
+
+        CompressedMesh mesh(&model, true);
+        fs::create_directories(fs::path(packName).parent_path(), fileError);
+        if (!mesh.save(packName)) {
+            messages.at(index) = "Pack: \'" + asset + "\' failed to save, its old pack is removed.";
+            fs::remove(packName, fileError);
+            numFailed++;
+            return;
+        }
+
+        entries.at(index) = entry;
+        succeeded.at(index) = 1;
+        bytesWritten += fs::file_size(packName, fileError);
+        numPacked++;
+    });
+
+    for (int i = 0; i < assets.size(); i++) {
+        if (!messages.at(i).empty()) {
+            cout << messages.at(i) << endl;
+        }
+    }
+
+    // Only assets that packed are kept, packs of removed ones are deleted
+    map<string, ManifestEntry> manifest;
+    unordered_set<string> current(assets.begin(), assets.end());
+    for (int i = 0; i < assets.size(); i++) {
+        if (succeeded.at(i)) {
+            manifest[assets.at(i)] = entries.at(i);
+        }
+    }
+    for (auto old = previous.begin(); old != previous.end(); old++) {
+        if (current.count(old->first) == 0) {
+            fs::remove(packFileName(outputDirectory, old->first), error);
+        }
+    }
+    writeManifest(manifestFileName, manifest);
+
+    auto finish = chrono::high_resolution_clock::now();
+    double seconds = chrono::duration_cast<chrono::duration<double>>(finish - start).count();
+    cout << "Pack: " << assets.size() << " assets, " << numPacked << " packed, " << numSkipped << " unchanged, " << numEmpty << " without triangles, " << numFailed << " failed, on " << getNumThreads(numThreads) << " threads." << endl;
+    cout << "Pack: " << seconds << " seconds, " << (seconds > 0 ? assets.size() / seconds : 0) << " assets/second." << endl;
+    cout << "Pack: " << bytesRead << " bytes read (" << (seconds > 0 ? bytesRead / seconds / 1e6 : 0) << " MB/s), " << bytesWritten << " bytes written." << endl;
+
+    return numFailed > 0 ? 1 : 0;
+}
+
+// 64 bit FNV-1a of a file's contents in hex, "missing" if it does not open
+string hashFile(string fileName, size_t* size) {
+    *size = 0;
+    ifstream file(fileName, ios::binary);
+    if (!file.is_open()) {
+        return "missing";
+    }
+
+    unsigned long long hash = 14695981039346656037ull;
+    vector<char> buffer(1 << 16);
+    while (file) {
+        file.read(buffer.data(), buffer.size());
+        streamsize count = file.gcount();
+        for (streamsize i = 0; i < count; i++) {
+            hash = (hash ^ (unsigned char) buffer[i]) * 1099511628211ull;
+        }
+        *size += count;
+    }
+
+    stringstream stream;
+    stream << hex << setw(16) << setfill('0') << hash;
+    return stream.str();
+}
+
+// Manifest: the header line, then per asset "<asset>\t<obj hash>" followed by "\t<mtl file>\t<mtl hash>" pairs
+map<string, ManifestEntry> readManifest(string fileName) {
+    map<string, ManifestEntry> manifest;
+    ifstream file(fileName);
+    string line;
+    if (!file.is_open() || !getline(file, line) || line != manifestHeader) {
+        return manifest;
+    }
+
+    while (getline(file, line)) {
+        vector<string> fields;
+        stringstream stream(line);
+        string field;
+        while (getline(stream, field, '\t')) {
+            fields.push_back(field);
+        }
+        if (fields.size() < 2 || fields.size() % 2 != 0) {
+            continue;
+        }
+
+        ManifestEntry entry;
+        entry.objHash = fields.at(1);
+        for (int i = 2; i < fields.size(); i += 2) {
+            entry.materialHashes.push_back(make_pair(fields.at(i), fields.at(i + 1)));
+        }
+        manifest[fields.at(0)] = entry;
+    }
+
+    return manifest;
+}
+
+// Written beside and renamed over the old one, so an interrupted run keeps the last manifest
+bool writeManifest(string fileName, const map<string, ManifestEntry>& manifest) {
+    string temporaryFileName = fileName + ".tmp";
+    ofstream file(temporaryFileName);
+    if (!file.is_open()) {
+        cout << "File: \'" << temporaryFileName << "\' failed to open." << endl;
+        return false;
+    }
+
+    file << manifestHeader << endl;
+    for (auto entry = manifest.begin(); entry != manifest.end(); entry++) {
+        file << entry->first << "\t" << entry->second.objHash;
+        for (int i = 0; i < entry->second.materialHashes.size(); i++) {
+            file << "\t" << entry->second.materialHashes.at(i).first << "\t" << entry->second.materialHashes.at(i).second;
+        }
+        file << endl;
+    }
+    file.close();
+
+    error_code error;
+    fs::rename(temporaryFileName, fileName, error);
+    if (error) {
+        cout << "File: \'" << fileName << "\' failed to open." << endl;
+        return false;
+    }
+
+    return true;
+}
+
+// <pack directory>/<asset path>.mtcm
+string packFileName(fs::path outputDirectory, string asset) {
+    return (outputDirectory / fs::path(asset).replace_extension(".mtcm")).string();
+}